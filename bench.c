@@ -0,0 +1,454 @@
+/**
+ * @file bench.c
+ * @author amitfr1
+ * @brief Throughput benchmark for the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * Measures bit_queue_read_bits throughput over a large stream with and without hugepage backed buffers,
+ * the throughput of a producer and a consumer thread sharing a queue and the throughput of writing a stream to
+ * several queues with and without bit_queue_write_bits_multi and the throughput of packing an array of integers
+ * with bit_queue_pack_u32 against writing the values one by one (out of line and with the inline fast path) and the decode throughput of delta coded timestamps.
+ * The rw section times single bit_queue_write_bits and bit_queue_read_bits calls over a matrix of bit counts,
+ * queue bit offsets, wrapping and non wrapping copies and queue sizes from L1 to DRAM, the clock overhead is
+ * subtracted from every sample. A wrapping sample costs a lap of the ring so those run on the smaller queues only.
+ * Every result is one line of the benchmark name followed by key=value fields so runs can be diffed and parsed.
+ * Build once more with -DBIT_QUEUE_PACKED_LAYOUT to compare against cursors that share a cache line.
+ * Usage: bench [stream size in MiB (default 1024)] [benchmark name prefix (default all)]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "bit_queue.h"
+#include "bit_queue_pack.h"
+#include "bit_queue_inline.h"
+
+#define CHUNK_BYTES (64 * 1024)
+#define MIB (1024 * 1024)
+#define SPSC_QUEUE_BYTES (64 * 1024)
+#define SPSC_CHUNK_BITS 512
+#define FANOUT_QUEUES 16
+#define FANOUT_QUEUE_BYTES (256 * 1024)
+#define FANOUT_MSG_BITS 4093
+#define PACK_VALUES 4096
+#define PACK_WIDTH 11
+#define PACK_MODE_WRITE_BITS 0
+#define PACK_MODE_INLINE 1
+#define PACK_MODE_U32 2
+#define MATRIX_OPS 1024
+#define MATRIX_MIN_OPS 8
+#define MATRIX_PAD_BYTES (4 * MIB)
+#define MATRIX_MAX_BITS 4096
+
+static const size_t matrix_bits[] = {1, 3, 8, 13, 32, 64, 100, 512, 1000, MATRIX_MAX_BITS};
+static const size_t matrix_queue_bytes[] = {16 * 1024, 256 * 1024, 4 * MIB, 32 * MIB};
+
+struct spsc_arg
+{
+    bit_queue_t * bq;
+    size_t byte_count;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static bool selected(const char *name, const char *only)
+{
+    return !strncmp(name, only, strlen(only));
+}
+
+static int bench_read(const char *name, size_t byte_count, uint32_t flags)
+{
+    static uint8_t chunk[CHUNK_BYTES];
+    bit_queue_attr_t attr;
+    bit_queue_t * bq;
+    size_t i;
+    double start, elapsed;
+    bit_queue_attr_init(&attr);
+    attr.flags = flags;
+    if (!(bq = bit_queue_base_init_attr(byte_count, &attr)))
+    {
+        perror(name);
+        return -1;
+    }
+    memset(chunk, 0x5a, sizeof(chunk));
+    for (i = 0; i < byte_count / CHUNK_BYTES; i++)
+    {
+        bit_queue_write_bits(bq, chunk, CHUNK_BYTES, CHUNK_BYTES * 8);
+    }
+    start = now_sec();
+    for (i = 0; i < byte_count / CHUNK_BYTES; i++)
+    {
+        // skew the reads by a few bits so the copy is not byte aligned
+        bit_queue_read_bits(bq, chunk, CHUNK_BYTES, CHUNK_BYTES * 8 - (i % 8));
+    }
+    elapsed = now_sec() - start;
+    printf("%s bytes=%zu read_mib_s=%.1f\n", name, byte_count, byte_count / elapsed / MIB);
+    bit_queue_destroy(bq);
+    return 0;
+}
+
+static void * spsc_producer(void *arg)
+{
+    struct spsc_arg * spsc = arg;
+    uint8_t chunk[SPSC_CHUNK_BITS / 8];
+    size_t i;
+    memset(chunk, 0x5a, sizeof(chunk));
+    for (i = 0; i < spsc->byte_count * 8 / SPSC_CHUNK_BITS; i++)
+    {
+        while (bit_queue_write_bits(spsc->bq, chunk, sizeof(chunk), SPSC_CHUNK_BITS) == -1 && errno == EAGAIN)
+        {
+        }
+    }
+    return NULL;
+}
+
+static int bench_spsc(const char *name, size_t byte_count)
+{
+    uint8_t chunk[SPSC_CHUNK_BITS / 8];
+    struct spsc_arg spsc;
+    pthread_t producer;
+    size_t i;
+    double start, elapsed;
+    if (!(spsc.bq = bit_queue_base_init(SPSC_QUEUE_BYTES)))
+    {
+        perror(name);
+        return -1;
+    }
+    spsc.byte_count = byte_count;
+    start = now_sec();
+    pthread_create(&producer, NULL, spsc_producer, &spsc);
+    for (i = 0; i < byte_count * 8 / SPSC_CHUNK_BITS; i++)
+    {
+        while (bit_queue_read_bits(spsc.bq, chunk, sizeof(chunk), SPSC_CHUNK_BITS) == -1 && errno == EAGAIN)
+        {
+        }
+    }
+    pthread_join(producer, NULL);
+    elapsed = now_sec() - start;
+    printf("%s bytes=%zu mib_s=%.1f\n", name, byte_count, byte_count / elapsed / MIB);
+    bit_queue_destroy(spsc.bq);
+    return 0;
+}
+
+static int bench_fanout(const char *name, size_t byte_count, bool multi)
+{
+    static uint8_t msg[(FANOUT_MSG_BITS + 7) / 8];
+    static uint8_t drain[FANOUT_QUEUE_BYTES];
+    bit_queue_t * queues[FANOUT_QUEUES];
+    size_t i, q, written = 0;
+    double start, elapsed = 0;
+    memset(msg, 0x5a, sizeof(msg));
+    for (q = 0; q < FANOUT_QUEUES; q++)
+    {
+        queues[q] = bit_queue_base_init(FANOUT_QUEUE_BYTES);
+    }
+    while (written < byte_count)
+    {
+        start = now_sec();
+        // fill the queues up to the last whole message
+        for (i = 0; i < FANOUT_QUEUE_BYTES * 8 / FANOUT_MSG_BITS; i++)
+        {
+            if (multi)
+            {
+                bit_queue_write_bits_multi(queues, FANOUT_QUEUES, msg, sizeof(msg), FANOUT_MSG_BITS);
+            }
+            else
+            {
+                for (q = 0; q < FANOUT_QUEUES; q++)
+                {
+                    bit_queue_write_bits(queues[q], msg, sizeof(msg), FANOUT_MSG_BITS);
+                }
+            }
+        }
+        elapsed += now_sec() - start;
+        written += i * FANOUT_MSG_BITS / 8;
+        for (q = 0; q < FANOUT_QUEUES; q++)
+        {
+            bit_queue_read_bits(queues[q], drain, sizeof(drain), i * FANOUT_MSG_BITS);
+        }
+    }
+    printf("%s queues=%d bytes=%zu mib_s=%.1f\n", name, FANOUT_QUEUES, written, written / elapsed / MIB);
+    for (q = 0; q < FANOUT_QUEUES; q++)
+    {
+        bit_queue_destroy(queues[q]);
+    }
+    return 0;
+}
+
+static int bench_pack(const char *name, size_t byte_count, int mode)
+{
+    static uint32_t values[PACK_VALUES];
+    bit_queue_t * bq;
+    size_t i, j, done = 0;
+    double start, elapsed;
+    if (!(bq = bit_queue_base_init(PACK_VALUES * sizeof(*values))))
+    {
+        perror(name);
+        return -1;
+    }
+    for (i = 0; i < PACK_VALUES; i++)
+    {
+        values[i] = (i * 2654435761U) & ((1U << PACK_WIDTH) - 1);
+    }
+    start = now_sec();
+    while (done < byte_count)
+    {
+        if (mode == PACK_MODE_U32)
+        {
+            bit_queue_pack_u32(bq, values, PACK_VALUES, PACK_WIDTH);
+            bit_queue_unpack_u32(bq, values, PACK_VALUES, PACK_WIDTH);
+        }
+        else if (mode == PACK_MODE_INLINE)
+        {
+            for (j = 0; j < PACK_VALUES; j++)
+            {
+                bit_queue_write_value(bq, values[j], PACK_WIDTH);
+            }
+            for (j = 0; j < PACK_VALUES; j++)
+            {
+                bit_queue_read_value(bq, &values[j], PACK_WIDTH);
+            }
+        }
+        else
+        {
+            for (j = 0; j < PACK_VALUES; j++)
+            {
+                bit_queue_write_bits(bq, (uint8_t *)&values[j], sizeof(*values), PACK_WIDTH);
+            }
+            for (j = 0; j < PACK_VALUES; j++)
+            {
+                bit_queue_read_bits(bq, (uint8_t *)&values[j], sizeof(*values), PACK_WIDTH);
+            }
+        }
+        done += sizeof(values);
+    }
+    elapsed = now_sec() - start;
+    printf("%s width=%d bytes=%zu mib_s=%.1f\n", name, PACK_WIDTH, done, done / elapsed / MIB);
+    bit_queue_destroy(bq);
+    return 0;
+}
+
+static int bench_delta(const char *name, size_t byte_count)
+{
+    static uint32_t values[PACK_VALUES];
+    bit_queue_t * bq;
+    size_t i, done = 0;
+    int bits = 0;
+    double elapsed = 0, start;
+    if (!(bq = bit_queue_base_init(PACK_VALUES * sizeof(*values))))
+    {
+        perror(name);
+        return -1;
+    }
+    while (done < byte_count)
+    {
+        // monotonic timestamps with a small jitter
+        for (i = 0; i < PACK_VALUES; i++)
+        {
+            values[i] = 1000000 + i * 1000 + (i * 2654435761U) % 64;
+        }
+        bits = bit_queue_write_delta_u32(bq, values, PACK_VALUES);
+        start = now_sec();
+        bit_queue_read_delta_u32(bq, values, PACK_VALUES);
+        elapsed += now_sec() - start;
+        done += sizeof(values);
+    }
+    printf("%s bits_per_value=%.2f bytes=%zu decode_mib_s=%.1f\n", name, (double)bits / PACK_VALUES, done, done / elapsed / MIB);
+    bit_queue_destroy(bq);
+    return 0;
+}
+
+static uint64_t clock_overhead_ns(void)
+{
+    uint64_t best = UINT64_MAX, start, elapsed;
+    int i;
+    for (i = 0; i < 1000; i++)
+    {
+        start = now_ns();
+        elapsed = now_ns() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    return best;
+}
+
+static void matrix_advance(bit_queue_t *bq, size_t queue_bytes, size_t *pos, size_t bit_count)
+{
+    static uint8_t pad[CHUNK_BYTES];
+    size_t chunk_bits = (queue_bytes < CHUNK_BYTES ? queue_bytes : CHUNK_BYTES) * 8;
+    size_t bits;
+    // move both cursors of the empty queue forward without timing it, byte aligned once the first chunk is done
+    for (; bit_count > 0; bit_count -= bits)
+    {
+        bits = bit_count < chunk_bits ? bit_count : chunk_bits;
+        bits = bits == bit_count || !(*pos % 8) ? bits : 8 - *pos % 8;
+        *pos = (*pos + bits) % (queue_bytes * 8);
+        bit_queue_write_bits(bq, pad, sizeof(pad), bits);
+        bit_queue_read_bits(bq, pad, sizeof(pad), bits);
+    }
+}
+
+static void matrix_report(const char *op, size_t queue_bytes, size_t bits, int offset, bool wrap, uint64_t *samples, size_t ops)
+{
+    uint64_t total = 0;
+    double mean;
+    size_t i;
+    qsort(samples, ops, sizeof(*samples), compare_u64);
+    for (i = 0; i < ops; i++)
+    {
+        total += samples[i];
+    }
+    mean = (double)total / ops;
+    printf("rw op=%s queue_bytes=%zu bits=%zu offset=%d wrap=%d ops=%zu ns_mean=%.1f ns_p50=%llu ns_p99=%llu mib_s=%.1f\n",
+           op, queue_bytes, bits, offset, wrap, ops, mean, (unsigned long long)samples[ops / 2],
+           (unsigned long long)samples[ops * 99 / 100], mean > 0 ? bits / 8.0 / mean * 1e9 / MIB : 0.0);
+}
+
+static void bench_matrix_cell(bit_queue_t *bq, size_t queue_bytes, size_t *pos, size_t bits, int offset, bool wrap, uint64_t overhead, uint64_t *samples)
+{
+    static uint8_t buffer[MATRIX_MAX_BITS / 8];
+    size_t ring_bits = queue_bytes * 8;
+    size_t target, i, ops = MATRIX_OPS;
+    uint64_t t0, t1, t2;
+    // a wrapping copy starts some whole bytes plus the offset before the end of the buffer
+    size_t tail = (bits / 2 + offset) / 8 > 1 ? (bits / 2 + offset) / 8 * 8 - offset : 8 - (size_t)offset;
+    if (wrap && tail >= bits)
+    {
+        // too short to straddle the end from this offset
+        ops = 0;
+    }
+    else if (wrap)
+    {
+        // every sample costs a lap of the ring so big queues get fewer samples or none
+        ops = MATRIX_PAD_BYTES / queue_bytes;
+        ops = ops < MATRIX_MIN_OPS ? 0 : ops > MATRIX_OPS ? MATRIX_OPS : ops;
+    }
+    for (i = 0; i < ops; i++)
+    {
+        if (wrap)
+        {
+            target = ring_bits - tail;
+        }
+        else
+        {
+            target = (*pos + 7 - offset) / 8 * 8 + offset;
+            target = target + bits > ring_bits ? (size_t)offset : target;
+        }
+        matrix_advance(bq, queue_bytes, pos, (target + ring_bits - *pos) % ring_bits);
+        t0 = now_ns();
+        bit_queue_write_bits(bq, buffer, sizeof(buffer), bits);
+        t1 = now_ns();
+        bit_queue_read_bits(bq, buffer, sizeof(buffer), bits);
+        t2 = now_ns();
+        samples[i] = t1 - t0 > overhead ? t1 - t0 - overhead : 0;
+        samples[ops + i] = t2 - t1 > overhead ? t2 - t1 - overhead : 0;
+        *pos = (target + bits) % ring_bits;
+    }
+    if (ops > 0)
+    {
+        matrix_report("write", queue_bytes, bits, offset, wrap, samples, ops);
+        matrix_report("read", queue_bytes, bits, offset, wrap, samples + ops, ops);
+    }
+}
+
+static int bench_matrix(void)
+{
+    static uint64_t samples[2 * MATRIX_OPS];
+    uint64_t overhead = clock_overhead_ns();
+    bit_queue_t * bq;
+    size_t q, b, pos;
+    int offset, wrap;
+    printf("rw clock_overhead_ns=%llu\n", (unsigned long long)overhead);
+    for (q = 0; q < sizeof(matrix_queue_bytes) / sizeof(*matrix_queue_bytes); q++)
+    {
+        if (!(bq = bit_queue_base_init(matrix_queue_bytes[q])))
+        {
+            perror("rw");
+            return -1;
+        }
+        // touch the whole buffer once so the first samples don't pay for page faults
+        pos = 0;
+        matrix_advance(bq, matrix_queue_bytes[q], &pos, matrix_queue_bytes[q] * 8);
+        for (b = 0; b < sizeof(matrix_bits) / sizeof(*matrix_bits); b++)
+        {
+            for (wrap = 0; wrap < 2; wrap++)
+            {
+                for (offset = 0; offset < 8; offset++)
+                {
+                    bench_matrix_cell(bq, matrix_queue_bytes[q], &pos, matrix_bits[b], offset, wrap, overhead, samples);
+                }
+            }
+        }
+        bit_queue_destroy(bq);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    size_t byte_count = (argc > 1 ? strtoul(argv[1], NULL, 0) : 1024) * MIB;
+    const char * only = argc > 2 ? argv[2] : "";
+    if (selected("read_bits", only))
+    {
+        bench_read("read_bits", byte_count, 0);
+    }
+    if (selected("read_bits_hugepage", only))
+    {
+        bench_read("read_bits_hugepage", byte_count, BIT_QUEUE_ATTR_HUGEPAGE);
+    }
+    if (selected("spsc", only))
+    {
+        bench_spsc("spsc", byte_count / 16);
+    }
+    if (selected("fanout_write_bits", only))
+    {
+        bench_fanout("fanout_write_bits", byte_count / 64, false);
+    }
+    if (selected("fanout_write_bits_multi", only))
+    {
+        bench_fanout("fanout_write_bits_multi", byte_count / 64, true);
+    }
+    if (selected("pack_write_bits", only))
+    {
+        bench_pack("pack_write_bits", byte_count / 64, PACK_MODE_WRITE_BITS);
+    }
+    if (selected("pack_inline", only))
+    {
+        bench_pack("pack_inline", byte_count / 16, PACK_MODE_INLINE);
+    }
+    if (selected("pack_u32", only))
+    {
+        bench_pack("pack_u32", byte_count / 16, PACK_MODE_U32);
+    }
+    if (selected("delta_u32", only))
+    {
+        bench_delta("delta_u32", byte_count / 16);
+    }
+    if (selected("rw", only))
+    {
+        bench_matrix();
+    }
+    return 0;
+}
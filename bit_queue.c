@@ -8,49 +8,103 @@
  * @ingroup bit_queue
  * 
  */
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
 #include "bit_queue.h"
+#include "bit_queue_internal.h"
 
 /**
- * @brief The number of bits in a byte
+ * @brief This define calculates the mask its shifted the the end of the byte
+ * @ingroup bit_queue
+ */ 
+#define CREATE_BYTE_MASK(bit_offset) ((BYTE_MASK << bit_offset) & BYTE_MASK)
+
+/**
+ * @brief This define calculates the mask and it starts from the LSB
  * @ingroup bit_queue
  */
-#define BITS_IN_BYTE 8
+#define CREATE_BYTE_MASK_LSB(bit_offset) (CREATE_BYTE_MASK(bit_offset) >> bit_offset)
 
 /**
- * @brief This is the mask of a byte
+ * @brief The size of a hugepage used to back large buffers
  * @ingroup bit_queue
  */
-#define BYTE_MASK 0x000000ff
+#define HUGEPAGE_SIZE (2UL * 1024 * 1024)
 
 /**
- * @brief This define calculates the mask its shifted the the end of the byte
+ * @brief This define rounds the value up to the given power of two alignment
  * @ingroup bit_queue
- */ 
-#define CREATE_BYTE_MASK(bit_offset) ((BYTE_MASK << bit_offset) & BYTE_MASK)
+ */
+#define ROUND_UP(value, align) (((value) + (align) - 1) & ~((size_t)(align) - 1))
 
 /**
- * @brief This define calculates the mask and it starts from the LSB
+ * @brief The maximal number of NUMA nodes supported by the node masks
  * @ingroup bit_queue
  */
-#define CREATE_BYTE_MASK_LSB(bit_offset) (CREATE_BYTE_MASK(bit_offset) >> bit_offset)
+#define MAX_NUMA_NODES 1024
+
+/**
+ * @brief The number of bits in an unsigned long
+ * @ingroup bit_queue
+ */
+#define BITS_IN_LONG (sizeof(unsigned long) * BITS_IN_BYTE)
+
+/**
+ * @brief The spin limits of the waiting functions before they go to sleep
+ * @ingroup bit_queue
+ */
+#define SPIN_MIN 16
+#define SPIN_MAX 4096
+
+/**
+ * @brief This define hints the cpu that we are in a spin loop
+ * @ingroup bit_queue
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define CPU_RELAX() __asm__ volatile("yield")
+#else
+#define CPU_RELAX()
+#endif
+
+/**
+ * @brief The value that marks an initialized shared memory segment ("bitqueue")
+ * @ingroup bit_queue
+ */
+#define SHM_MAGIC 0x6575657571746962ULL
+
+/**
+ * @brief All the attribute flags known by this version
+ * @ingroup bit_queue
+ */
+#define BIT_QUEUE_ATTR_ALL (BIT_QUEUE_ATTR_HUGEPAGE | BIT_QUEUE_ATTR_EVENTFD)
 
 /**
- * @brief This stuct holds all the fields used in the bit queue
+ * @brief This stuct is placed at the start of a shared memory segment that holds a bit queue.
+ * The buffer is located by its offset from the segment start so each process can map the segment at any address.
  * 
  * @ingroup bit_queue
  */
-struct _bit_queue_t
-{
-    uint8_t * buffer; /// The buffer that holds all of the data
-    uint8_t r_bit_offset; /// An index used to follow the bit progression in a byte while reading
-    size_t r_byte_offset; /// An index used to follow byte progression while reading
-    uint8_t w_bit_offset; /// An index used to follow the bit progression in a byte while writing
-    size_t w_byte_offset; /// An index used to follow byte progression while writing
-    size_t written_bits; /// The number of bits that hold data in the buffer
-    size_t buffer_size; /// The buffer size in bits
-    bool free_buff; /// An indication that the buffer should be freed with the bit queue
+struct _bit_queue_shm_header
+{
+    BIT_QUEUE_ATOMIC(uint64_t) magic; /// Set to SHM_MAGIC once the segment is initialized
+    uint64_t buffer_offset; /// The offset of the buffer from the start of the segment
+    uint64_t buffer_size; /// The buffer size in bytes
+    struct _bit_queue_shared shared; /// The published counters
 };
 
 /**
@@ -78,53 +132,251 @@ struct _bit_queue_t
 static int bit_queue_bit_buffer_copy(uint8_t * dst_buff, uint8_t * src_buff, size_t dst_byte_offset, uint8_t dst_bit_offset, size_t dst_buff_size, size_t src_byte_offset, size_t src_bit_offset, size_t src_buff_size, size_t bit_count);
 
 /**
- * @brief This function checks if there is enough space to write all of the bits
+ * @brief This function checks the arguments of bit_queue_write_bits_multi and that all the queues have space
  * 
- * Sets errno to EINVAL if bq = NULL
+ * errno options:
+ * 1) Sets errno EINVAL if queues = NULL or count = 0 or one of the queues is invalid
+ * 2) Sets errno to EMSGSIZE if the bit count is larger than one of the bit queue buffers
+ * 3) Sets errno to EAGAIN if one of the queues doesn't have enough space
  * 
  * @ingroup bit_queue
  * 
- * @param bq The bit queue
- * @param bit_count The number of bits we want to write
- * @return true if there is sufficient space in the queue false otherwise 
+ * @param queues The destination bit queues
+ * @param count The number of queues
+ * @param bit_count The amount of bits to write
+ * @return true if all of the queues can be written false otherwise
+ */
+static bool bit_queue_multi_check(bit_queue_t **queues, size_t count, size_t bit_count);
+
+/**
+ * @brief This function shifts the source bits so they start at the given bit offset of the first byte.
+ * The shifted bits can then be copied byte by byte to any queue whose write cursor is on the same bit offset.
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param shifted The destination, must hold (bit_offset + bit_count + 7) / 8 bytes
+ * @param buffer The source buffer
+ * @param bit_offset The bit offset of the destination
+ * @param bit_count The amount of bits to shift
+ */
+static void bit_queue_shift_bits(uint8_t *shifted, const uint8_t *buffer, uint8_t bit_offset, size_t bit_count);
+
+/**
+ * @brief This function writes shifted bits at the write cursor (whose bit offset matches the shift) and advances it.
+ * The inner bytes are copied whole and only the edge bytes are merged with the bits already in the buffer.
+ * The caller must check that the queue has space and publish the written bits.
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The destination bit queue
+ * @param shifted The bits shifted to the bit offset of the write cursor
+ * @param bit_count The amount of bits to write
+ */
+static void bit_queue_put_shifted(bit_queue_t *bq, const uint8_t *shifted, size_t bit_count);
+
+/**
+ * @brief This function waits until the counter of the opposite side reaches the target count.
+ * It spins for an adaptive period and then sleeps on the futex until the opposite side wakes it.
+ * 
+ * errno options:
+ * 1) Sets errno to ETIMEDOUT if the deadline passed
+ * 2) The errno is set by futex
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param count The counter of the opposite side
+ * @param target The count to wait for
+ * @param futex The futex the opposite side bumps when it wakes us
+ * @param futex_flags The flags of the futex operations
+ * @param wait_count Where the target is published to the opposite side
+ * @param spin_limit The adaptive spin limit of the waiting side
+ * @param deadline An absolute CLOCK_MONOTONIC deadline or NULL to wait forever
+ * @return int 0 in success or -1 in failure
+ */
+static int bit_queue_wait(BIT_QUEUE_ATOMIC(size_t) *count, size_t target, BIT_QUEUE_ATOMIC(uint32_t) *futex, int futex_flags, BIT_QUEUE_ATOMIC(size_t) *wait_count, size_t *spin_limit, const struct timespec *deadline);
+
+/**
+ * @brief This function converts a relative timeout to an absolute CLOCK_MONOTONIC deadline
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param timeout The relative timeout or NULL
+ * @param deadline The deadline to fill
+ * @return const struct timespec* The deadline or NULL if there is no timeout
+ */
+static const struct timespec * bit_queue_deadline(const struct timespec *timeout, struct timespec *deadline);
+
+/**
+ * @brief This function makes the eventfd readable unless it already is
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param fd The eventfd
+ * @param raised Whether the eventfd is readable
+ */
+static void bit_queue_event_raise(int fd, BIT_QUEUE_ATOMIC(bool) *raised);
+
+/**
+ * @brief This function drains the eventfd if it is readable
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param fd The eventfd
+ * @param raised Whether the eventfd is readable
  */
-static bool bit_queue_has_space(bit_queue_t *bq, size_t bit_count);
+static void bit_queue_event_clear(int fd, BIT_QUEUE_ATOMIC(bool) *raised);
 
 /**
- * @brief This function checks if there is enough data to read
+ * @brief This function creates the eventfds of the queue
  * 
- * Sets errno to EINVAL if bq = NULL
+ * errno options:
+ * 1) Sets errno to EINVAL if a watermark is 0 or larger than the bit queue buffer
+ * 2) The errno is set by eventfd
  * 
  * @ingroup bit_queue
  * 
  * @param bq The bit queue
- * @param bit_count The number of bits we want to read
- * @return true if there is sufficient data in the queue false otherwise 
+ * @param attr The attributes of the bit queue
+ * @return int 0 in success or -1 in failure
+ */
+static int bit_queue_event_init(bit_queue_t *bq, const bit_queue_attr_t *attr);
+
+/**
+ * @brief This function allocates a zeroed bit queue struct aligned to a cache line
+ * 
+ * The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue
+ * 
+ * @return bit_queue_t* The bit queue or NULL in failure
+ */
+static bit_queue_t * bit_queue_alloc(void);
+
+/**
+ * @brief This function creates a bit queue handle over an initialized shared memory segment.
+ * The cursors of the handle are restored from the published counters.
+ * 
+ * errno options:
+ * 1) Sets errno to EINVAL if the segment isn't a valid bit queue segment
+ * 2) The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param header The mapped segment
+ * @param map_size The size of the mapped segment
+ * @return bit_queue_t* The bit queue or NULL in failure
+ */
+static bit_queue_t * bit_queue_shm_map(struct _bit_queue_shm_header *header, size_t map_size);
+
+/**
+ * @brief This function maps a buffer backed by hugepages
+ * An explicit hugepage mapping is tried first and if it fails a 2 MiB aligned mapping is advised to use transparent hugepages.
+ * 
+ * The errno is set by the mapping method
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param byte_count The size of the buffer in bytes
+ * @param map_size Returns the size of the mapping (byte_count rounded up to the hugepage size)
+ * @return uint8_t* The mapped buffer or NULL in failure
+ */
+static uint8_t * bit_queue_hugepage_alloc(size_t byte_count, size_t *map_size);
+
+/**
+ * @brief This function allocates the bit queue buffer according to the attributes
+ * 
+ * The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue that will own the buffer
+ * @param byte_count The size of the buffer in bytes
+ * @param attr The attributes of the bit queue
+ * @return int 0 in success or -1 in failure
+ */
+static int bit_queue_buffer_alloc(bit_queue_t *bq, size_t byte_count, const bit_queue_attr_t *attr);
+
+/**
+ * @brief This function maps a page aligned buffer so a memory policy can be applied to it
+ * 
+ * The errno is set by the mapping method
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param byte_count The size of the buffer in bytes
+ * @param map_size Returns the size of the mapping (byte_count rounded up to the page size)
+ * @return uint8_t* The mapped buffer or NULL in failure
  */
-static bool bit_queue_has_data(bit_queue_t *bq, size_t bit_count);
+static uint8_t * bit_queue_page_alloc(size_t byte_count, size_t *map_size);
+
+/**
+ * @brief This function binds the mapped buffer to a NUMA node, it must be called before the buffer is touched
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if the node is invalid
+ * 2) The errno is set by getcpu or mbind
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param buffer The mapped buffer
+ * @param map_size The size of the mapping
+ * @param numa_node The NUMA node or BIT_QUEUE_NUMA_LOCAL
+ * @return int 0 in success or -1 in failure
+ */
+static int bit_queue_numa_bind(uint8_t *buffer, size_t map_size, int numa_node);
 
 bit_queue_t * bit_queue_base_init(size_t byte_count)
+{
+    bit_queue_attr_t attr;
+    bit_queue_attr_init(&attr);
+    return bit_queue_base_init_attr(byte_count, &attr);
+}
+
+int bit_queue_attr_init(bit_queue_attr_t *attr)
+{
+    int ret_val = -1;
+    if (attr == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        attr->flags = 0;
+        attr->numa_node = BIT_QUEUE_NUMA_ANY;
+        attr->read_watermark = 1;
+        attr->write_watermark = 1;
+        ret_val = 0;
+    }
+    return ret_val;
+}
+
+bit_queue_t * bit_queue_base_init_attr(size_t byte_count, const bit_queue_attr_t *attr)
 {
     bit_queue_t * bq = NULL;
-    if (!byte_count)
+    if (!byte_count || attr == NULL || (attr->flags & ~BIT_QUEUE_ATTR_ALL) || attr->numa_node < BIT_QUEUE_NUMA_LOCAL || attr->numa_node >= MAX_NUMA_NODES)
     {
         errno = EINVAL;
     }
-    else if (!(bq = calloc(1, sizeof(struct _bit_queue_t))))
+    else if (!(bq = bit_queue_alloc()))
     {
-        // errno is set by calloc and bq = NULL
+        // errno is set by bit_queue_alloc and bq = NULL
     }
-    else if (!(bq->buffer = calloc(byte_count, sizeof(uint8_t))))
+    else if (bit_queue_buffer_alloc(bq, byte_count, attr) == -1)
     {
-        // errno is set by calloc and bq->buffer = NULL
+        // errno is set by the allocation method and bq->buffer = NULL
         free(bq);
         bq = NULL;
     }
     else
     {
         bq->buffer_size = byte_count;
-        bq->written_bits = 0;
         bq->free_buff = true;
+        if ((attr->flags & BIT_QUEUE_ATTR_EVENTFD) && bit_queue_event_init(bq, attr) == -1)
+        {
+            // errno is set by bit_queue_event_init
+            bit_queue_destroy(bq);
+            bq = NULL;
+        }
     }
     return bq;
 }
@@ -136,26 +388,222 @@ bit_queue_t * bit_queue_init(uint8_t * buffer, size_t byte_count, bool free_buff
     {
         errno = EINVAL;
     }
-    else if (!(bq = calloc(1, sizeof(struct _bit_queue_t))))
+    else if (!(bq = bit_queue_alloc()))
     {
-        // errno is set by calloc and bq = NULL
+        // errno is set by bit_queue_alloc and bq = NULL
     }
     else
     {
         bq->buffer = buffer;
         bq->buffer_size = byte_count;
-        bq->written_bits = byte_count * BITS_IN_BYTE;
+        BIT_QUEUE_STORE(&bq->shared->write_count, byte_count * BITS_IN_BYTE, relaxed);
+        bq->w_count_cache = byte_count * BITS_IN_BYTE;
+#ifdef BIT_QUEUE_STATS
+        // the initial data wasn't written through the queue
+        bq->stat_write_base = byte_count * BITS_IN_BYTE;
+#endif
         bq->free_buff = free_buff;
     }
     return bq;
 }
 
+bit_queue_t * bit_queue_shm_create(const char *name, size_t byte_count)
+{
+    bit_queue_t * bq = NULL;
+    int fd = -1;
+    size_t buffer_offset = ROUND_UP(sizeof(struct _bit_queue_shm_header), CACHE_LINE_SIZE);
+    struct _bit_queue_shm_header * header;
+    if (name == NULL || !byte_count)
+    {
+        errno = EINVAL;
+    }
+    else if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) == -1)
+    {
+        // errno is set by shm_open
+    }
+    else if (ftruncate(fd, buffer_offset + byte_count) == -1)
+    {
+        // errno is set by ftruncate
+        shm_unlink(name);
+    }
+    else if ((header = mmap(NULL, buffer_offset + byte_count, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        // errno is set by mmap
+        shm_unlink(name);
+    }
+    else
+    {
+        // the segment is zeroed by ftruncate so the counters start at 0
+        header->buffer_offset = buffer_offset;
+        header->buffer_size = byte_count;
+        BIT_QUEUE_STORE(&header->magic, SHM_MAGIC, release);
+        if (!(bq = bit_queue_shm_map(header, buffer_offset + byte_count)))
+        {
+            // errno is set by bit_queue_shm_map
+            munmap(header, buffer_offset + byte_count);
+            shm_unlink(name);
+        }
+    }
+    if (fd != -1)
+    {
+        close(fd);
+    }
+    return bq;
+}
+
+bit_queue_t * bit_queue_shm_attach(const char *name)
+{
+    bit_queue_t * bq = NULL;
+    int fd = -1;
+    struct stat st;
+    struct _bit_queue_shm_header * header;
+    if (name == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if ((fd = shm_open(name, O_RDWR, 0)) == -1)
+    {
+        // errno is set by shm_open
+    }
+    else if (fstat(fd, &st) == -1)
+    {
+        // errno is set by fstat
+    }
+    else if ((size_t)st.st_size <= sizeof(struct _bit_queue_shm_header))
+    {
+        // the segment wasn't created by bit_queue_shm_create
+        errno = EINVAL;
+    }
+    else if ((header = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        // errno is set by mmap
+    }
+    else if (!(bq = bit_queue_shm_map(header, st.st_size)))
+    {
+        // errno is set by bit_queue_shm_map
+        munmap(header, st.st_size);
+    }
+    if (fd != -1)
+    {
+        close(fd);
+    }
+    return bq;
+}
+
+int bit_queue_numa_node(bit_queue_t *bq)
+{
+    int ret_val = -1;
+    int node;
+    if (bq == NULL || bq->buffer == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if (syscall(SYS_get_mempolicy, &node, NULL, 0, bq->buffer, MPOL_F_NODE | MPOL_F_ADDR) == -1)
+    {
+        // errno is set by get_mempolicy
+    }
+    else
+    {
+        ret_val = node;
+    }
+    return ret_val;
+}
+
+int bit_queue_numa_pin_thread(bit_queue_t *bq)
+{
+    int ret_val = -1;
+    int node;
+    int first, last;
+    char path[64];
+    FILE * cpulist = NULL;
+    cpu_set_t cpus;
+    if ((node = bit_queue_numa_node(bq)) == -1)
+    {
+        // errno is set by bit_queue_numa_node
+    }
+    else if (snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node) < 0)
+    {
+        // errno is set by snprintf
+    }
+    else if (!(cpulist = fopen(path, "r")))
+    {
+        // errno is set by fopen
+    }
+    else
+    {
+        // the cpulist format is a comma separated list of ranges (e.g 0-3,8-11)
+        CPU_ZERO(&cpus);
+        while (fscanf(cpulist, "%d", &first) == 1)
+        {
+            last = first;
+            if (fscanf(cpulist, "-%d", &last) < 0)
+            {
+                last = first;
+            }
+            for (; first <= last && first < CPU_SETSIZE; first++)
+            {
+                CPU_SET(first, &cpus);
+            }
+            if (fgetc(cpulist) != ',')
+            {
+                break;
+            }
+        }
+        if (!CPU_COUNT(&cpus))
+        {
+            // a memory only node
+            errno = EINVAL;
+        }
+        else if (sched_setaffinity(0, sizeof(cpus), &cpus) == -1)
+        {
+            // errno is set by sched_setaffinity
+        }
+        else
+        {
+            ret_val = 0;
+        }
+        fclose(cpulist);
+    }
+    return ret_val;
+}
+
+int bit_queue_read_fd(bit_queue_t *bq)
+{
+    int ret_val = -1;
+    if (bq == NULL || bq->buffer == NULL || bq->data_fd == -1)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        ret_val = bq->data_fd;
+    }
+    return ret_val;
+}
+
+int bit_queue_write_fd(bit_queue_t *bq)
+{
+    int ret_val = -1;
+    if (bq == NULL || bq->buffer == NULL || bq->space_fd == -1)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        ret_val = bq->space_fd;
+    }
+    return ret_val;
+}
+
 int bit_queue_read_bits(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, size_t bit_count)
 {
     int ret_val = -1;
     size_t b_byte_offset;
     uint8_t b_bit_offset;
     size_t r_bits;
+#ifdef BIT_QUEUE_LATENCY
+    uint64_t start = bit_queue_latency_ticks();
+#endif
     if (bq == NULL || buffer == NULL || bit_count == 0 || buffer_size * BITS_IN_BYTE < bit_count)
     {
         // ret_val already set
@@ -176,6 +624,8 @@ int bit_queue_read_bits(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, si
     {
         // ret_val already set
         errno = EAGAIN;
+        BIT_QUEUE_STAT_ADD(bq->r_stat_eagain, 1);
+        BIT_QUEUE_PROBE(read_eagain, bq, bit_count, BIT_QUEUE_READER_FILL(bq));
     }
     else
     {
@@ -190,26 +640,28 @@ int bit_queue_read_bits(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, si
                 break;
             }
             // update the buffer counters
-            b_bit_offset += ret_val;
-            b_byte_offset += b_bit_offset / BITS_IN_BYTE;
-            b_bit_offset = b_bit_offset % BITS_IN_BYTE;
+            // the sums are taken before narrowing, a copy can be far longer than a uint8_t offset
+            b_byte_offset += (b_bit_offset + ret_val) / BITS_IN_BYTE;
+            b_bit_offset = (b_bit_offset + ret_val) % BITS_IN_BYTE;
 
             // update the bit queue buffer counters
-            bq->r_bit_offset += ret_val;
-            bq->r_byte_offset += bq->r_bit_offset / BITS_IN_BYTE;
-            bq->r_bit_offset = bq->r_bit_offset % BITS_IN_BYTE;
+            bq->r_byte_offset += (bq->r_bit_offset + ret_val) / BITS_IN_BYTE;
+            bq->r_bit_offset = (bq->r_bit_offset + ret_val) % BITS_IN_BYTE;
             if (bq->r_byte_offset == bq->buffer_size)
             {
                 bq->r_byte_offset = 0;
                 // bq->bit_offset should already be 0
                 bq->r_bit_offset = 0;
             }
-            bq->written_bits -= ret_val;
             r_bits -= ret_val;
         } while (r_bits > 0);
         if (ret_val != -1)
         {
+            bit_queue_publish_read(bq, bit_count);
             ret_val = bit_count;
+#ifdef BIT_QUEUE_LATENCY
+            bit_queue_latency_record(&bq->latency->read, bit_queue_latency_ticks() - start);
+#endif
         }
     }
     return ret_val;
@@ -221,6 +673,10 @@ int bit_queue_write_bits(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, s
     size_t b_byte_offset;
     uint8_t b_bit_offset;
     size_t r_bits;
+    size_t w_bits;
+#ifdef BIT_QUEUE_LATENCY
+    uint64_t start = bit_queue_latency_ticks();
+#endif
     if (bq == NULL || buffer == NULL || bit_count == 0 || buffer_size * BITS_IN_BYTE < bit_count)
     {
         // ret_val already set
@@ -241,6 +697,8 @@ int bit_queue_write_bits(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, s
     {
         // ret_val already set
         errno = EAGAIN;
+        BIT_QUEUE_STAT_ADD(bq->w_stat_eagain, 1);
+        BIT_QUEUE_PROBE(write_eagain, bq, bit_count, BIT_QUEUE_WRITER_FILL(bq));
     }
     else
     {
@@ -249,54 +707,255 @@ int bit_queue_write_bits(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, s
         b_byte_offset = 0;
         do
         {
-            ret_val = bit_queue_bit_buffer_copy(bq->buffer, buffer, bq->w_byte_offset, bq->w_bit_offset, bq->buffer_size, b_byte_offset, b_bit_offset, buffer_size, r_bits);
+            // the copy can only clamp the source so stop it at the end of the bit queue buffer
+            w_bits = (bq->buffer_size - bq->w_byte_offset) * BITS_IN_BYTE - bq->w_bit_offset;
+            ret_val = bit_queue_bit_buffer_copy(bq->buffer, buffer, bq->w_byte_offset, bq->w_bit_offset, bq->buffer_size, b_byte_offset, b_bit_offset, buffer_size, r_bits < w_bits ? r_bits : w_bits);
             if (ret_val == -1)
             {
                 break;
             }
             // update the buffer counters
-            b_bit_offset += ret_val;
-            b_byte_offset += b_bit_offset / BITS_IN_BYTE;
-            b_bit_offset = b_bit_offset % BITS_IN_BYTE;
+            // the sums are taken before narrowing, a copy can be far longer than a uint8_t offset
+            b_byte_offset += (b_bit_offset + ret_val) / BITS_IN_BYTE;
+            b_bit_offset = (b_bit_offset + ret_val) % BITS_IN_BYTE;
 
             // update the bit queue buffer counters
-            bq->w_bit_offset += ret_val;
-            bq->w_byte_offset += bq->w_bit_offset / BITS_IN_BYTE;
-            bq->w_bit_offset = bq->w_bit_offset % BITS_IN_BYTE;
+            bq->w_byte_offset += (bq->w_bit_offset + ret_val) / BITS_IN_BYTE;
+            bq->w_bit_offset = (bq->w_bit_offset + ret_val) % BITS_IN_BYTE;
             if (bq->w_byte_offset == bq->buffer_size)
             {
                 bq->w_byte_offset = 0;
                 // bq->bit_offset should already be 0
-                bq->w_byte_offset = 0;
+                bq->w_bit_offset = 0;
             }
-            bq->written_bits += ret_val;
             r_bits -= ret_val;
         } while (r_bits > 0);
         if (ret_val != -1)
         {
+            bit_queue_publish_write(bq, bit_count);
             ret_val = bit_count;
+#ifdef BIT_QUEUE_LATENCY
+            bit_queue_latency_record(&bq->latency->write, bit_queue_latency_ticks() - start);
+#endif
         }
     }
     return ret_val;
 }
 
-int bit_queue_destroy(bit_queue_t *bq)
+int bit_queue_write_bits_multi(bit_queue_t **queues, size_t count, uint8_t *buffer, size_t buffer_size, size_t bit_count)
 {
     int ret_val = -1;
-    if (bq == NULL)
+    uint8_t * shifted = NULL;
+    uint8_t * written;
+    uint8_t bit_offset;
+    size_t i, j;
+    if (queues == NULL || buffer == NULL || bit_count == 0 || buffer_size * BITS_IN_BYTE < bit_count)
     {
+        // ret_val already set
         errno = EINVAL;
     }
-    else if (bq->buffer == NULL)
+    else if (!bit_queue_multi_check(queues, count, bit_count))
     {
-        errno = EINVAL;
+        // ret_val already set and errno is set by bit_queue_multi_check
+    }
+    else if (!(shifted = malloc((bit_count + 2 * BITS_IN_BYTE - 1) / BITS_IN_BYTE + count)))
+    {
+        // errno is set by malloc
     }
     else
     {
-        if (bq->free_buff)
+        // the shift is done once per distinct write bit offset and shared by all the queues on that offset,
+        // the offsets move once a queue is written so the written queues are marked
+        written = shifted + (bit_count + 2 * BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+        memset(written, 0, count);
+        for (i = 0; i < count; i++)
         {
-            free(bq->buffer);
+            if (written[i])
+            {
+                continue;
+            }
+            bit_offset = queues[i]->w_bit_offset;
+            bit_queue_shift_bits(shifted, buffer, bit_offset, bit_count);
+            for (j = i; j < count; j++)
+            {
+                if (!written[j] && queues[j]->w_bit_offset == bit_offset)
+                {
+                    bit_queue_put_shifted(queues[j], shifted, bit_count);
+                    bit_queue_publish_write(queues[j], bit_count);
+                    written[j] = 1;
+                }
+            }
         }
+        free(shifted);
+        ret_val = bit_count;
+    }
+    return ret_val;
+}
+
+int bit_queue_transfer(bit_queue_t *dst, bit_queue_t *src, size_t bit_count)
+{
+    int ret_val = -1;
+    size_t r_bits;
+    size_t chunk;
+    size_t src_end;
+    size_t dst_end;
+    if (dst == NULL || src == NULL || dst == src || bit_count == 0 || dst->buffer == NULL || src->buffer == NULL)
+    {
+        // ret_val already set
+        errno = EINVAL;
+    }
+    else if (bit_count > dst->buffer_size * BITS_IN_BYTE || bit_count > src->buffer_size * BITS_IN_BYTE)
+    {
+        // ret_val already set
+        errno = EMSGSIZE;
+    }
+    else if (!bit_queue_has_data(src, bit_count))
+    {
+        // ret_val already set
+        errno = EAGAIN;
+        BIT_QUEUE_STAT_ADD(src->r_stat_eagain, 1);
+        BIT_QUEUE_PROBE(read_eagain, src, bit_count, BIT_QUEUE_READER_FILL(src));
+    }
+    else if (!bit_queue_has_space(dst, bit_count))
+    {
+        // ret_val already set
+        errno = EAGAIN;
+        BIT_QUEUE_STAT_ADD(dst->w_stat_eagain, 1);
+        BIT_QUEUE_PROBE(write_eagain, dst, bit_count, BIT_QUEUE_WRITER_FILL(dst));
+    }
+    else
+    {
+        r_bits = bit_count;
+        do
+        {
+            // each chunk ends at the closest of the two wrap points
+            src_end = (src->buffer_size - src->r_byte_offset) * BITS_IN_BYTE - src->r_bit_offset;
+            dst_end = (dst->buffer_size - dst->w_byte_offset) * BITS_IN_BYTE - dst->w_bit_offset;
+            chunk = r_bits < src_end ? r_bits : src_end;
+            chunk = chunk < dst_end ? chunk : dst_end;
+            ret_val = bit_queue_bit_buffer_copy(dst->buffer, src->buffer, dst->w_byte_offset, dst->w_bit_offset, dst->buffer_size, src->r_byte_offset, src->r_bit_offset, src->buffer_size, chunk);
+            if (ret_val == -1)
+            {
+                break;
+            }
+            bit_queue_advance_read(src, ret_val);
+            bit_queue_advance_write(dst, ret_val);
+            r_bits -= ret_val;
+        } while (r_bits > 0);
+        if (ret_val != -1)
+        {
+            bit_queue_publish_read(src, bit_count);
+            bit_queue_publish_write(dst, bit_count);
+            ret_val = bit_count;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_read_bits_wait(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, size_t bit_count, const struct timespec *timeout)
+{
+    int ret_val;
+    struct timespec deadline_buff;
+    const struct timespec * deadline = bit_queue_deadline(timeout, &deadline_buff);
+    while ((ret_val = bit_queue_read_bits(bq, buffer, buffer_size, bit_count)) == -1 && errno == EAGAIN)
+    {
+        if (bit_queue_wait(&bq->shared->write_count, BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed) + bit_count, &bq->shared->data_futex, bq->futex_flags, &bq->shared->r_wait_count, &bq->r_spin_limit, deadline) == -1)
+        {
+            // errno is set by bit_queue_wait
+            break;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_write_bits_wait(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, size_t bit_count, const struct timespec *timeout)
+{
+    int ret_val;
+    struct timespec deadline_buff;
+    const struct timespec * deadline = bit_queue_deadline(timeout, &deadline_buff);
+    while ((ret_val = bit_queue_write_bits(bq, buffer, buffer_size, bit_count)) == -1 && errno == EAGAIN)
+    {
+        // wait until the reader frees enough space for the write
+        if (bit_queue_wait(&bq->shared->read_count, BIT_QUEUE_LOAD(&bq->shared->write_count, relaxed) + bit_count - bq->buffer_size * BITS_IN_BYTE, &bq->shared->space_futex, bq->futex_flags, &bq->shared->w_wait_count, &bq->w_spin_limit, deadline) == -1)
+        {
+            // errno is set by bit_queue_wait
+            break;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_get_stats(bit_queue_t *bq, bit_queue_stats_t *stats)
+{
+    int ret_val = -1;
+#ifdef BIT_QUEUE_STATS
+    size_t buffer_bits;
+    size_t read_count, write_count;
+#endif
+    if (bq == NULL || stats == NULL || bq->buffer == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+#ifdef BIT_QUEUE_STATS
+        // the bits and the wraps follow from the published counters since the cursors sit at count % buffer bits
+        buffer_bits = bq->buffer_size * BITS_IN_BYTE;
+        read_count = BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed);
+        write_count = BIT_QUEUE_LOAD(&bq->shared->write_count, relaxed);
+        stats->bits_read = read_count - bq->stat_read_base;
+        stats->bits_written = write_count - bq->stat_write_base;
+        stats->read_wraps = read_count / buffer_bits - bq->stat_read_base / buffer_bits;
+        stats->write_wraps = write_count / buffer_bits - bq->stat_write_base / buffer_bits;
+        stats->reads = BIT_QUEUE_LOAD(&bq->r_stat_calls, relaxed);
+        stats->writes = BIT_QUEUE_LOAD(&bq->w_stat_calls, relaxed);
+        stats->read_eagain = BIT_QUEUE_LOAD(&bq->r_stat_eagain, relaxed);
+        stats->write_eagain = BIT_QUEUE_LOAD(&bq->w_stat_eagain, relaxed);
+        stats->high_water_bits = BIT_QUEUE_LOAD(&bq->w_stat_high_water, relaxed);
+        ret_val = 0;
+#else
+        errno = ENOTSUP;
+#endif
+    }
+    return ret_val;
+}
+
+int bit_queue_destroy(bit_queue_t *bq)
+{
+    int ret_val = -1;
+    if (bq == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if (bq->buffer == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        if (bq->shm_base != NULL)
+        {
+            munmap(bq->shm_base, bq->map_size);
+        }
+        else if (bq->free_buff && bq->map_size)
+        {
+            munmap(bq->buffer, bq->map_size);
+        }
+        else if (bq->free_buff)
+        {
+            free(bq->buffer);
+        }
+        if (bq->data_fd != -1)
+        {
+            close(bq->data_fd);
+        }
+        if (bq->space_fd != -1)
+        {
+            close(bq->space_fd);
+        }
+#ifdef BIT_QUEUE_LATENCY
+        free(bq->latency);
+#endif
         bq->buffer = NULL;
         free(bq);
         ret_val = 0;
@@ -316,8 +975,10 @@ static int bit_queue_bit_buffer_copy(uint8_t * dst_buff, uint8_t * src_buff, siz
         // ret_val already set
         errno = EINVAL;
     }
-    // checking that the size values are valid
-    else if (bit_count == 0 || dst_buff_size < dst_byte_offset || src_buff_size < src_byte_offset || dst_bit_offset >= BITS_IN_BYTE || src_bit_offset >= BITS_IN_BYTE || src_buff_size * BITS_IN_BYTE < bit_count)
+    // checking that the size values are valid, the source must have at least one bit left after its offsets
+    else if (bit_count == 0 || dst_bit_offset >= BITS_IN_BYTE || src_bit_offset >= BITS_IN_BYTE ||
+             dst_buff_size * BITS_IN_BYTE < dst_byte_offset * BITS_IN_BYTE + dst_bit_offset ||
+             src_buff_size * BITS_IN_BYTE <= src_byte_offset * BITS_IN_BYTE + src_bit_offset || src_buff_size * BITS_IN_BYTE < bit_count)
     {
         // ret_val already set
         errno = EINVAL;
@@ -356,7 +1017,9 @@ static int bit_queue_bit_buffer_copy(uint8_t * dst_buff, uint8_t * src_buff, siz
             }
             // copy all the bits we can into the buffer
             // because the buffer and the bq buffer can be on diffrent bit offsets we need to shift it back and forth
-            dst_buff[dst_byte_offset] |= ((src_buff[src_byte_offset] & (CREATE_BYTE_MASK_LSB(offset_bit_count) << src_bit_offset)) >> src_bit_offset) << dst_bit_offset;
+            // the destination bits are cleared first since the buffer may hold stale data
+            dst_buff[dst_byte_offset] = (dst_buff[dst_byte_offset] & ~(CREATE_BYTE_MASK_LSB(offset_bit_count) << dst_bit_offset)) |
+                (((src_buff[src_byte_offset] & (CREATE_BYTE_MASK_LSB(offset_bit_count) << src_bit_offset)) >> src_bit_offset) << dst_bit_offset);
 
             // update the bit counters
             src_bit_offset += (BITS_IN_BYTE - offset_bit_count);
@@ -382,30 +1045,617 @@ static int bit_queue_bit_buffer_copy(uint8_t * dst_buff, uint8_t * src_buff, siz
 }
 
 
-static bool bit_queue_has_space(bit_queue_t *bq, size_t bit_count)
+bool bit_queue_has_space(bit_queue_t *bq, size_t bit_count)
 {
     bool ret_val = false;
+    size_t write_count;
     if (bq == NULL)
     {
         errno = EINVAL;
     }
-    else if ((bq->buffer_size * BITS_IN_BYTE) - bq->written_bits >= bit_count)
+    else
     {
-        ret_val = true;
+        write_count = BIT_QUEUE_LOAD(&bq->shared->write_count, relaxed);
+        if ((bq->buffer_size * BITS_IN_BYTE) - (write_count - bq->r_count_cache) < bit_count)
+        {
+            // the cached read count is stale, reload it from the reader
+            bq->r_count_cache = BIT_QUEUE_LOAD(&bq->shared->read_count, acquire);
+        }
+        ret_val = (bq->buffer_size * BITS_IN_BYTE) - (write_count - bq->r_count_cache) >= bit_count;
     }
     return ret_val;
 }
 
-static bool bit_queue_has_data(bit_queue_t *bq, size_t bit_count)
+bool bit_queue_has_data(bit_queue_t *bq, size_t bit_count)
 {
     bool ret_val = false;
+    size_t read_count;
     if (bq == NULL)
     {
         errno = EINVAL;
     }
-    else if (bq->written_bits >= bit_count)
+    else
+    {
+        read_count = BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed);
+        if (bq->w_count_cache - read_count < bit_count)
+        {
+            // the cached write count is stale, reload it from the writer
+            bq->w_count_cache = BIT_QUEUE_LOAD(&bq->shared->write_count, acquire);
+        }
+        ret_val = bq->w_count_cache - read_count >= bit_count;
+    }
+    return ret_val;
+}
+
+static bool bit_queue_multi_check(bit_queue_t **queues, size_t count, size_t bit_count)
+{
+    bool ret_val = count > 0;
+    size_t i;
+    if (!count)
+    {
+        errno = EINVAL;
+    }
+    for (i = 0; i < count && ret_val; i++)
     {
-        ret_val = true;
+        ret_val = false;
+        if (queues[i] == NULL || queues[i]->buffer == NULL)
+        {
+            errno = EINVAL;
+        }
+        else if (bit_count > queues[i]->buffer_size * BITS_IN_BYTE)
+        {
+            errno = EMSGSIZE;
+        }
+        else if (!bit_queue_has_space(queues[i], bit_count))
+        {
+            errno = EAGAIN;
+            BIT_QUEUE_STAT_ADD(queues[i]->w_stat_eagain, 1);
+            BIT_QUEUE_PROBE(write_eagain, queues[i], bit_count, BIT_QUEUE_WRITER_FILL(queues[i]));
+        }
+        else
+        {
+            ret_val = true;
+        }
     }
     return ret_val;
-}
\ No newline at end of file
+}
+
+static void bit_queue_shift_bits(uint8_t *shifted, const uint8_t *buffer, uint8_t bit_offset, size_t bit_count)
+{
+    size_t byte_count = (bit_count + BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+    size_t i;
+    if (!bit_offset)
+    {
+        memcpy(shifted, buffer, byte_count);
+    }
+    else
+    {
+        shifted[0] = buffer[0] << bit_offset;
+        for (i = 1; i < byte_count; i++)
+        {
+            shifted[i] = (buffer[i] << bit_offset) | (buffer[i - 1] >> (BITS_IN_BYTE - bit_offset));
+        }
+        // the last source bits may spill to an extra byte
+        shifted[byte_count] = buffer[byte_count - 1] >> (BITS_IN_BYTE - bit_offset);
+    }
+}
+
+static void bit_queue_put_shifted(bit_queue_t *bq, const uint8_t *shifted, size_t bit_count)
+{
+    size_t span = (bq->w_bit_offset + bit_count + BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+    size_t end_bit = (bq->w_bit_offset + bit_count) % BITS_IN_BYTE;
+    size_t first = bq->w_byte_offset;
+    size_t last = (first + span - 1) % bq->buffer_size;
+    size_t inner_start = (first + 1) % bq->buffer_size;
+    size_t inner_count = span > 2 ? span - 2 : 0;
+    size_t head;
+    uint8_t first_mask = CREATE_BYTE_MASK(bq->w_bit_offset);
+    uint8_t last_mask = (1U << end_bit) - 1;
+    if (!end_bit)
+    {
+        last_mask = BYTE_MASK;
+    }
+    // the inner bytes are entirely free so they are copied whole (wrapping at the end of the buffer)
+    head = inner_count < bq->buffer_size - inner_start ? inner_count : bq->buffer_size - inner_start;
+    memcpy(bq->buffer + inner_start, shifted + 1, head);
+    memcpy(bq->buffer, shifted + 1 + head, inner_count - head);
+    // the edge bytes may hold unread bits that must keep their values
+    if (span == 1)
+    {
+        first_mask &= last_mask;
+        bq->buffer[first] = (bq->buffer[first] & ~first_mask) | (shifted[0] & first_mask);
+    }
+    else if (first == last)
+    {
+        // the write wraps around the buffer and ends in the byte it started in
+        bq->buffer[first] = (bq->buffer[first] & ~(first_mask | last_mask)) | (shifted[0] & first_mask) | (shifted[span - 1] & last_mask);
+    }
+    else
+    {
+        bq->buffer[first] = (bq->buffer[first] & ~first_mask) | (shifted[0] & first_mask);
+        bq->buffer[last] = (bq->buffer[last] & ~last_mask) | (shifted[span - 1] & last_mask);
+    }
+    bq->w_byte_offset = (first + (bq->w_bit_offset + bit_count) / BITS_IN_BYTE) % bq->buffer_size;
+    bq->w_bit_offset = end_bit;
+}
+
+size_t bit_queue_peek_bits(bit_queue_t *bq, size_t skip, uint64_t *window)
+{
+    size_t avail;
+    size_t bit_pos;
+    size_t byte_offset;
+    uint8_t bit_offset;
+    size_t i;
+    uint64_t word;
+    uint64_t value = 0;
+    // refreshes the cached write count when it doesn't cover a full window
+    bit_queue_has_data(bq, skip + WINDOW_BITS);
+    avail = bq->w_count_cache - BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed);
+    avail = avail > skip ? avail - skip : 0;
+    avail = avail < WINDOW_BITS ? avail : WINDOW_BITS;
+    bit_pos = bq->r_byte_offset * BITS_IN_BYTE + bq->r_bit_offset + skip;
+    if (bit_pos >= bq->buffer_size * BITS_IN_BYTE)
+    {
+        bit_pos -= bq->buffer_size * BITS_IN_BYTE;
+    }
+    byte_offset = bit_pos / BITS_IN_BYTE;
+    bit_offset = bit_pos % BITS_IN_BYTE;
+    if (byte_offset + sizeof(word) < bq->buffer_size)
+    {
+        // one unaligned load and the spill byte
+        memcpy(&word, bq->buffer + byte_offset, sizeof(word));
+        value = le64toh(word) >> bit_offset;
+        if (bit_offset)
+        {
+            value |= (uint64_t)bq->buffer[byte_offset + sizeof(word)] << (WINDOW_BITS - bit_offset);
+        }
+    }
+    else if (avail)
+    {
+        // gather the bytes one by one, wrapping at the end of the buffer
+        value = bq->buffer[byte_offset] >> bit_offset;
+        for (i = 1; i * BITS_IN_BYTE < avail + bit_offset; i++)
+        {
+            byte_offset = byte_offset + 1 == bq->buffer_size ? 0 : byte_offset + 1;
+            value |= (uint64_t)bq->buffer[byte_offset] << (i * BITS_IN_BYTE - bit_offset);
+        }
+    }
+    if (avail < WINDOW_BITS)
+    {
+        value &= (1ULL << avail) - 1;
+    }
+    *window = value;
+    return avail;
+}
+
+void bit_queue_put_bits(bit_queue_t *bq, uint64_t value, size_t bit_count)
+{
+    uint64_t mask = bit_count < WINDOW_BITS ? (1ULL << bit_count) - 1 : ~0ULL;
+    uint64_t word;
+    uint8_t * pos = bq->buffer + bq->w_byte_offset;
+    uint8_t byte_mask;
+    size_t n;
+    value &= mask;
+    if (bq->w_byte_offset + sizeof(word) < bq->buffer_size)
+    {
+        // merge into one unaligned word and the spill byte
+        memcpy(&word, pos, sizeof(word));
+        word = htole64((le64toh(word) & ~(mask << bq->w_bit_offset)) | (value << bq->w_bit_offset));
+        memcpy(pos, &word, sizeof(word));
+        if (bq->w_bit_offset + bit_count > WINDOW_BITS)
+        {
+            pos[sizeof(word)] = (pos[sizeof(word)] & ~(mask >> (WINDOW_BITS - bq->w_bit_offset))) | (value >> (WINDOW_BITS - bq->w_bit_offset));
+        }
+        bit_queue_advance_write(bq, bit_count);
+    }
+    else
+    {
+        // merge byte by byte, wrapping at the end of the buffer
+        while (bit_count > 0)
+        {
+            n = (size_t)(BITS_IN_BYTE - bq->w_bit_offset);
+            n = n < bit_count ? n : bit_count;
+            byte_mask = ((1U << n) - 1) << bq->w_bit_offset;
+            bq->buffer[bq->w_byte_offset] = (bq->buffer[bq->w_byte_offset] & ~byte_mask) | ((value << bq->w_bit_offset) & byte_mask);
+            value >>= n;
+            bit_count -= n;
+            bit_queue_advance_write(bq, n);
+        }
+    }
+}
+
+void bit_queue_advance_read(bit_queue_t *bq, size_t bit_count)
+{
+    size_t bit_pos = bq->r_byte_offset * BITS_IN_BYTE + bq->r_bit_offset + bit_count;
+    if (bit_pos >= bq->buffer_size * BITS_IN_BYTE)
+    {
+        bit_pos -= bq->buffer_size * BITS_IN_BYTE;
+    }
+    bq->r_byte_offset = bit_pos / BITS_IN_BYTE;
+    bq->r_bit_offset = bit_pos % BITS_IN_BYTE;
+}
+
+void bit_queue_advance_write(bit_queue_t *bq, size_t bit_count)
+{
+    size_t bit_pos = bq->w_byte_offset * BITS_IN_BYTE + bq->w_bit_offset + bit_count;
+    if (bit_pos >= bq->buffer_size * BITS_IN_BYTE)
+    {
+        bit_pos -= bq->buffer_size * BITS_IN_BYTE;
+    }
+    bq->w_byte_offset = bit_pos / BITS_IN_BYTE;
+    bq->w_bit_offset = bit_pos % BITS_IN_BYTE;
+}
+
+void bit_queue_publish_read(bit_queue_t *bq, size_t bit_count)
+{
+    size_t read_count = BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed) + bit_count;
+    // the store must be ordered before the load of the waiting target (pairs with bit_queue_wait)
+    BIT_QUEUE_STORE(&bq->shared->read_count, read_count, seq_cst);
+    BIT_QUEUE_STAT_ADD(bq->r_stat_calls, 1);
+    BIT_QUEUE_PROBE(read, bq, bit_count, bq->w_count_cache - read_count);
+    // the cursor was advanced before publishing so it is behind the read bits only if they crossed the buffer end
+    if (bq->r_byte_offset * BITS_IN_BYTE + bq->r_bit_offset < bit_count)
+    {
+        BIT_QUEUE_PROBE(read_wrap, bq, bit_count, bq->w_count_cache - read_count);
+    }
+#ifdef BIT_QUEUE_LATENCY
+    bit_queue_latency_collect(bq->latency, read_count);
+#endif
+    bit_queue_notify_read(bq, read_count);
+}
+
+void bit_queue_notify_read(bit_queue_t *bq, size_t read_count)
+{
+    size_t target = BIT_QUEUE_LOAD(&bq->shared->w_wait_count, seq_cst);
+    if (target && read_count >= target)
+    {
+        BIT_QUEUE_FETCH_ADD(&bq->shared->space_futex, 1, release);
+        syscall(SYS_futex, &bq->shared->space_futex, FUTEX_WAKE | bq->futex_flags, 1, NULL, NULL, 0);
+    }
+    if (bq->data_fd != -1)
+    {
+        if (BIT_QUEUE_LOAD(&bq->shared->write_count, seq_cst) - read_count < bq->read_watermark)
+        {
+            bit_queue_event_clear(bq->data_fd, &bq->shared->data_raised);
+            // the writer may have crossed the watermark while the fd was raised and skipped raising it
+            if (BIT_QUEUE_LOAD(&bq->shared->write_count, seq_cst) - read_count >= bq->read_watermark)
+            {
+                bit_queue_event_raise(bq->data_fd, &bq->shared->data_raised);
+            }
+        }
+        if (bq->buffer_size * BITS_IN_BYTE - (BIT_QUEUE_LOAD(&bq->shared->write_count, seq_cst) - read_count) >= bq->write_watermark)
+        {
+            bit_queue_event_raise(bq->space_fd, &bq->shared->space_raised);
+        }
+    }
+}
+
+void bit_queue_publish_write(bit_queue_t *bq, size_t bit_count)
+{
+    size_t write_count = BIT_QUEUE_LOAD(&bq->shared->write_count, relaxed) + bit_count;
+    // the store must be ordered before the load of the waiting target (pairs with bit_queue_wait)
+    BIT_QUEUE_STORE(&bq->shared->write_count, write_count, seq_cst);
+    BIT_QUEUE_STAT_ADD(bq->w_stat_calls, 1);
+    BIT_QUEUE_PROBE(write, bq, bit_count, write_count - bq->r_count_cache);
+    // the cursor was advanced before publishing so it is behind the written bits only if they crossed the buffer end
+    if (bq->w_byte_offset * BITS_IN_BYTE + bq->w_bit_offset < bit_count)
+    {
+        BIT_QUEUE_PROBE(write_wrap, bq, bit_count, write_count - bq->r_count_cache);
+    }
+#ifdef BIT_QUEUE_STATS
+    if (write_count - bq->r_count_cache > BIT_QUEUE_LOAD(&bq->w_stat_high_water, relaxed))
+    {
+        BIT_QUEUE_STORE(&bq->w_stat_high_water, write_count - bq->r_count_cache, relaxed);
+    }
+#endif
+#ifdef BIT_QUEUE_LATENCY
+    bit_queue_latency_stamp(bq->latency, write_count);
+#endif
+    bit_queue_notify_write(bq, write_count);
+}
+
+void bit_queue_notify_write(bit_queue_t *bq, size_t write_count)
+{
+    size_t target = BIT_QUEUE_LOAD(&bq->shared->r_wait_count, seq_cst);
+    if (target && write_count >= target)
+    {
+        BIT_QUEUE_FETCH_ADD(&bq->shared->data_futex, 1, release);
+        syscall(SYS_futex, &bq->shared->data_futex, FUTEX_WAKE | bq->futex_flags, 1, NULL, NULL, 0);
+    }
+    if (bq->space_fd != -1)
+    {
+        if (bq->buffer_size * BITS_IN_BYTE - (write_count - BIT_QUEUE_LOAD(&bq->shared->read_count, seq_cst)) < bq->write_watermark)
+        {
+            bit_queue_event_clear(bq->space_fd, &bq->shared->space_raised);
+            // the reader may have crossed the watermark while the fd was raised and skipped raising it
+            if (bq->buffer_size * BITS_IN_BYTE - (write_count - BIT_QUEUE_LOAD(&bq->shared->read_count, seq_cst)) >= bq->write_watermark)
+            {
+                bit_queue_event_raise(bq->space_fd, &bq->shared->space_raised);
+            }
+        }
+        if (write_count - BIT_QUEUE_LOAD(&bq->shared->read_count, seq_cst) >= bq->read_watermark)
+        {
+            bit_queue_event_raise(bq->data_fd, &bq->shared->data_raised);
+        }
+    }
+}
+
+static int bit_queue_wait(BIT_QUEUE_ATOMIC(size_t) *count, size_t target, BIT_QUEUE_ATOMIC(uint32_t) *futex, int futex_flags, BIT_QUEUE_ATOMIC(size_t) *wait_count, size_t *spin_limit, const struct timespec *deadline)
+{
+    int ret_val = 0;
+    size_t spins;
+    uint32_t seq;
+    // spin first, the opposite side is usually about to cross the target
+    for (spins = 0; spins < *spin_limit && BIT_QUEUE_LOAD(count, acquire) < target; spins++)
+    {
+        CPU_RELAX();
+    }
+    if (spins < *spin_limit)
+    {
+        // spinning paid off, allow longer spins next time
+        *spin_limit = spins * 2 > SPIN_MAX ? SPIN_MAX : (spins * 2 < SPIN_MIN ? SPIN_MIN : spins * 2);
+    }
+    else
+    {
+        // spinning didn't pay off, spin less next time
+        *spin_limit = *spin_limit / 2 < SPIN_MIN ? SPIN_MIN : *spin_limit / 2;
+        seq = BIT_QUEUE_LOAD(futex, acquire);
+        // publish the target before checking the counter again (pairs with bit_queue_publish_*)
+        BIT_QUEUE_STORE(wait_count, target, seq_cst);
+        // the futex returns immediately if the opposite side woke us after we read the sequence
+        if (BIT_QUEUE_LOAD(count, seq_cst) < target &&
+            syscall(SYS_futex, futex, FUTEX_WAIT_BITSET | futex_flags, seq, deadline, NULL, FUTEX_BITSET_MATCH_ANY) == -1 && errno != EAGAIN && errno != EINTR)
+        {
+            // errno is set by futex (ETIMEDOUT when the deadline passed)
+            ret_val = -1;
+        }
+        BIT_QUEUE_STORE(wait_count, 0, relaxed);
+    }
+    return ret_val;
+}
+
+static const struct timespec * bit_queue_deadline(const struct timespec *timeout, struct timespec *deadline)
+{
+    const struct timespec * ret_val = NULL;
+    if (timeout != NULL)
+    {
+        clock_gettime(CLOCK_MONOTONIC, deadline);
+        deadline->tv_sec += timeout->tv_sec;
+        deadline->tv_nsec += timeout->tv_nsec;
+        if (deadline->tv_nsec >= 1000000000L)
+        {
+            deadline->tv_sec++;
+            deadline->tv_nsec -= 1000000000L;
+        }
+        ret_val = deadline;
+    }
+    return ret_val;
+}
+
+static void bit_queue_event_raise(int fd, BIT_QUEUE_ATOMIC(bool) *raised)
+{
+    if (!BIT_QUEUE_EXCHANGE(raised, true, seq_cst))
+    {
+        eventfd_write(fd, 1);
+    }
+}
+
+static void bit_queue_event_clear(int fd, BIT_QUEUE_ATOMIC(bool) *raised)
+{
+    eventfd_t value;
+    if (BIT_QUEUE_LOAD(raised, seq_cst))
+    {
+        // the raising side may not have written the fd yet, wait for it so the fd isn't left readable
+        while (eventfd_read(fd, &value) == -1 && errno == EAGAIN)
+        {
+            sched_yield();
+        }
+        BIT_QUEUE_STORE(raised, false, seq_cst);
+    }
+}
+
+static int bit_queue_event_init(bit_queue_t *bq, const bit_queue_attr_t *attr)
+{
+    int ret_val = -1;
+    if (!attr->read_watermark || !attr->write_watermark || attr->read_watermark > bq->buffer_size * BITS_IN_BYTE || attr->write_watermark > bq->buffer_size * BITS_IN_BYTE)
+    {
+        errno = EINVAL;
+    }
+    else if ((bq->data_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+    {
+        // errno is set by eventfd
+    }
+    else if ((bq->space_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+    {
+        // errno is set by eventfd
+    }
+    else
+    {
+        bq->read_watermark = attr->read_watermark;
+        bq->write_watermark = attr->write_watermark;
+        // the queue starts empty
+        bit_queue_event_raise(bq->space_fd, &bq->shared->space_raised);
+        ret_val = 0;
+    }
+    return ret_val;
+}
+
+static bit_queue_t * bit_queue_alloc(void)
+{
+    bit_queue_t * bq;
+    if ((bq = aligned_alloc(CACHE_LINE_SIZE, ROUND_UP(sizeof(struct _bit_queue_t), CACHE_LINE_SIZE))))
+    {
+        memset(bq, 0, sizeof(struct _bit_queue_t));
+        bq->shared = &bq->local;
+        bq->futex_flags = FUTEX_PRIVATE_FLAG;
+        bq->r_spin_limit = SPIN_MIN;
+        bq->w_spin_limit = SPIN_MIN;
+        bq->data_fd = -1;
+        bq->space_fd = -1;
+#ifdef BIT_QUEUE_LATENCY
+        if (!(bq->latency = bit_queue_latency_create()))
+        {
+            // errno is set by bit_queue_latency_create
+            free(bq);
+            bq = NULL;
+        }
+#endif
+    }
+    return bq;
+}
+
+static bit_queue_t * bit_queue_shm_map(struct _bit_queue_shm_header *header, size_t map_size)
+{
+    bit_queue_t * bq = NULL;
+    size_t read_count, write_count;
+    if (BIT_QUEUE_LOAD(&header->magic, acquire) != SHM_MAGIC || header->buffer_offset < sizeof(struct _bit_queue_shm_header) ||
+        !header->buffer_size || header->buffer_offset + header->buffer_size != map_size)
+    {
+        errno = EINVAL;
+    }
+    else if (!(bq = bit_queue_alloc()))
+    {
+        // errno is set by bit_queue_alloc and bq = NULL
+    }
+    else
+    {
+        bq->shm_base = header;
+        bq->map_size = map_size;
+        bq->buffer = (uint8_t *)header + header->buffer_offset;
+        bq->buffer_size = header->buffer_size;
+        bq->free_buff = true;
+        bq->shared = &header->shared;
+        // the futexes are shared with other processes
+        bq->futex_flags = 0;
+        // another handle may have already used the queue, continue from the published counters
+        read_count = BIT_QUEUE_LOAD(&bq->shared->read_count, acquire);
+        write_count = BIT_QUEUE_LOAD(&bq->shared->write_count, acquire);
+        bq->r_byte_offset = read_count % (bq->buffer_size * BITS_IN_BYTE) / BITS_IN_BYTE;
+        bq->r_bit_offset = read_count % BITS_IN_BYTE;
+        bq->w_byte_offset = write_count % (bq->buffer_size * BITS_IN_BYTE) / BITS_IN_BYTE;
+        bq->w_bit_offset = write_count % BITS_IN_BYTE;
+        bq->w_count_cache = write_count;
+        bq->r_count_cache = read_count;
+#ifdef BIT_QUEUE_STATS
+        bq->stat_read_base = read_count;
+        bq->stat_write_base = write_count;
+#endif
+    }
+    return bq;
+}
+
+static uint8_t * bit_queue_hugepage_alloc(size_t byte_count, size_t *map_size)
+{
+    uint8_t * buff = NULL;
+    uint8_t * raw;
+    uint8_t * aligned;
+    size_t size = ROUND_UP(byte_count, HUGEPAGE_SIZE);
+    raw = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (raw != MAP_FAILED)
+    {
+        buff = raw;
+    }
+    // no reserved hugepages, map an extra hugepage so the buffer can be aligned for transparent hugepages
+    else if ((raw = mmap(NULL, size + HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+    {
+        // errno is set by mmap and buff = NULL
+    }
+    else
+    {
+        // trim the unaligned head and the tail of the mapping
+        aligned = (uint8_t *)ROUND_UP((uintptr_t)raw, HUGEPAGE_SIZE);
+        if (aligned != raw)
+        {
+            munmap(raw, aligned - raw);
+        }
+        munmap(aligned + size, raw + HUGEPAGE_SIZE - aligned);
+        // a failure only means that transparent hugepages are disabled, the buffer is still usable
+        madvise(aligned, size, MADV_HUGEPAGE);
+        buff = aligned;
+    }
+    if (buff != NULL)
+    {
+        *map_size = size;
+    }
+    return buff;
+}
+
+static int bit_queue_buffer_alloc(bit_queue_t *bq, size_t byte_count, const bit_queue_attr_t *attr)
+{
+    int ret_val = -1;
+    if (attr->flags & BIT_QUEUE_ATTR_HUGEPAGE)
+    {
+        bq->buffer = bit_queue_hugepage_alloc(byte_count, &bq->map_size);
+    }
+    else if (attr->numa_node != BIT_QUEUE_NUMA_ANY)
+    {
+        // a memory policy can only be applied to whole pages
+        bq->buffer = bit_queue_page_alloc(byte_count, &bq->map_size);
+    }
+    else
+    {
+        bq->buffer = calloc(byte_count, sizeof(uint8_t));
+        bq->map_size = 0;
+    }
+    if (bq->buffer == NULL)
+    {
+        // errno is set by the allocation method
+    }
+    else if (attr->numa_node != BIT_QUEUE_NUMA_ANY && bit_queue_numa_bind(bq->buffer, bq->map_size, attr->numa_node) == -1)
+    {
+        // errno is set by bit_queue_numa_bind
+        munmap(bq->buffer, bq->map_size);
+        bq->buffer = NULL;
+    }
+    else
+    {
+        ret_val = 0;
+    }
+    return ret_val;
+}
+
+static uint8_t * bit_queue_page_alloc(size_t byte_count, size_t *map_size)
+{
+    uint8_t * buff = NULL;
+    size_t size = ROUND_UP(byte_count, (size_t)sysconf(_SC_PAGESIZE));
+    if ((buff = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+    {
+        // errno is set by mmap
+        buff = NULL;
+    }
+    else
+    {
+        *map_size = size;
+    }
+    return buff;
+}
+
+static int bit_queue_numa_bind(uint8_t *buffer, size_t map_size, int numa_node)
+{
+    int ret_val = -1;
+    unsigned int cpu;
+    unsigned int node = numa_node;
+    unsigned long nodemask[MAX_NUMA_NODES / BITS_IN_LONG] = {0};
+    if (numa_node == BIT_QUEUE_NUMA_LOCAL && syscall(SYS_getcpu, &cpu, &node, NULL) == -1)
+    {
+        // errno is set by getcpu
+    }
+    else if (node >= MAX_NUMA_NODES)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        nodemask[node / BITS_IN_LONG] = 1UL << (node % BITS_IN_LONG);
+        // the kernel reads maxnode - 1 bits from the mask
+        if (syscall(SYS_mbind, buffer, map_size, MPOL_BIND, nodemask, MAX_NUMA_NODES + 1, 0) == -1)
+        {
+            // errno is set by mbind
+        }
+        else
+        {
+            ret_val = 0;
+        }
+    }
+    return ret_val;
+}
@@ -7,15 +7,83 @@
  * @defgroup bit_queue
  * This module was created for supporting read and write operations on a buffer with diffrent bit sizes.
  * This module supports a normal circular queue for bits and working with a given data full queue.
+ * A queue can be used concurrently by one reader thread and one writer thread.
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 
 #ifndef BIT_QUEUE_H_
 #define BIT_QUEUE_H_
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef struct _bit_queue_t bit_queue_t;
 
+/**
+ * @brief Back the queue buffer with 2 MiB hugepages.
+ * An explicit MAP_HUGETLB mapping is tried first, if the system has no reserved hugepages
+ * the buffer falls back to a 2 MiB aligned mapping advised with MADV_HUGEPAGE (transparent hugepages).
+ * @ingroup bit_queue
+ */
+#define BIT_QUEUE_ATTR_HUGEPAGE 0x00000001
+
+/**
+ * @brief Expose eventfds that follow the queue level so the queue can be multiplexed with epoll.
+ * The read fd is readable while at least read_watermark bits hold data and the write fd is readable while at least
+ * write_watermark bits are free. The fds are drained by the queue itself, they must only be polled.
+ * @ingroup bit_queue
+ */
+#define BIT_QUEUE_ATTR_EVENTFD 0x00000002
+
+/**
+ * @brief Don't place the buffer on a specific NUMA node (the default)
+ * @ingroup bit_queue
+ */
+#define BIT_QUEUE_NUMA_ANY (-1)
+
+/**
+ * @brief Place the buffer on the NUMA node of the thread creating the queue.
+ * Create the queue from the consumer thread to keep the buffer local to the consumer.
+ * @ingroup bit_queue
+ */
+#define BIT_QUEUE_NUMA_LOCAL (-2)
+
+/**
+ * @brief This stuct holds the optional attributes used when creating a bit queue
+ * 
+ * @ingroup bit_queue
+ */
+typedef struct _bit_queue_attr_t
+{
+    uint32_t flags; /// A combination of the BIT_QUEUE_ATTR_* flags
+    int numa_node; /// The NUMA node the buffer is bound to, BIT_QUEUE_NUMA_ANY or BIT_QUEUE_NUMA_LOCAL
+    size_t read_watermark; /// The number of data bits that makes the read fd readable (BIT_QUEUE_ATTR_EVENTFD)
+    size_t write_watermark; /// The number of free bits that makes the write fd readable (BIT_QUEUE_ATTR_EVENTFD)
+} bit_queue_attr_t;
+
+/**
+ * @brief This stuct holds a snapshot of the statistics of a bit queue (built with BIT_QUEUE_STATS)
+ * The bit and wrap counts cover the queue since the handle was created, the call and EAGAIN counts are kept by the
+ * handle itself, so with a queue shared between processes they count the calls made through this handle.
+ * 
+ * @ingroup bit_queue
+ */
+typedef struct _bit_queue_stats_t
+{
+    size_t bits_written; /// The number of bits written
+    size_t bits_read; /// The number of bits read
+    size_t writes; /// The number of calls of any module that wrote bits
+    size_t reads; /// The number of calls of any module that read bits
+    size_t write_eagain; /// The number of bit_queue_write_bits, bit_queue_write_bits_multi and bit_queue_transfer calls that failed with EAGAIN
+    size_t read_eagain; /// The number of bit_queue_read_bits and bit_queue_transfer calls that failed with EAGAIN
+    size_t high_water_bits; /// The largest number of bits held by the queue as seen by the writer after a write
+    size_t write_wraps; /// The number of times the write cursor went back to the start of the buffer
+    size_t read_wraps; /// The number of times the read cursor went back to the start of the buffer
+} bit_queue_stats_t;
+
 /**
  * @brief This function allocates the bit_queue and buffer and initializes it 
  * errno options:
@@ -30,6 +98,35 @@ typedef struct _bit_queue_t bit_queue_t;
  */
 bit_queue_t * bit_queue_base_init(size_t byte_count);
 
+/**
+ * @brief This function sets the attributes to their default values (the values used by bit_queue_base_init)
+ * 
+ * Sets errno to EINVAL if attr = NULL
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param attr The attributes to initialize
+ * 
+ * @return int 0 in success or -1 in failure
+ */
+int bit_queue_attr_init(bit_queue_attr_t *attr);
+
+/**
+ * @brief This function allocates the bit_queue and buffer according to the given attributes and initializes it
+ * errno options:
+ * 1) Sets errno EINVAL if byte_count = 0 or attr = NULL or attr->flags holds unknown flags or attr->numa_node is invalid
+ *    or a watermark is 0 or larger than the bit queue buffer
+ * 2) The errno is set by the allocation method, mbind or eventfd
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param byte_count the size of the bit queue buffer in bytes
+ * @param attr The attributes of the bit queue
+ * 
+ * @return bit_queue_t* Address of the created bit queue or NULL in failure
+ */
+bit_queue_t * bit_queue_base_init_attr(size_t byte_count, const bit_queue_attr_t *attr);
+
 /**
  * @brief This function allocates the bit_queue sets the buffer and initializes it. The function assumes that the buffer is full of data.
  * 
@@ -47,6 +144,97 @@ bit_queue_t * bit_queue_base_init(size_t byte_count);
  */
 bit_queue_t * bit_queue_init(uint8_t *buffer, size_t byte_count, bool free_buff);
 
+/**
+ * @brief This function creates a bit queue in a new POSIX shared memory segment so it can be shared between processes.
+ * The segment holds the buffer and the published counters, the data path doesn't use any syscalls or copies.
+ * One process reads and one process writes, each uses its own handle (the creator's or one from bit_queue_shm_attach).
+ * The segment stays until shm_unlink(name) is called.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if name = NULL or byte_count = 0
+ * 2) The errno is set by shm_open, ftruncate, mmap or the allocation method (EEXIST if the segment already exists)
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param name The name of the shared memory segment (see shm_open)
+ * @param byte_count The size of the bit queue buffer in bytes
+ * 
+ * @return bit_queue_t* Address of the created bit queue or NULL in failure
+ */
+bit_queue_t * bit_queue_shm_create(const char *name, size_t byte_count);
+
+/**
+ * @brief This function attaches to a bit queue created by bit_queue_shm_create, possibly in another process
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if name = NULL or the segment doesn't hold a bit queue
+ * 2) The errno is set by shm_open, fstat, mmap or the allocation method
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param name The name of the shared memory segment
+ * 
+ * @return bit_queue_t* Address of the attached bit queue or NULL in failure
+ */
+bit_queue_t * bit_queue_shm_attach(const char *name);
+
+/**
+ * @brief This function returns the NUMA node that holds the bit queue buffer (the node of its first page)
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL
+ * 2) The errno is set by get_mempolicy
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * 
+ * @return int The NUMA node of the buffer or -1 in failure
+ */
+int bit_queue_numa_node(bit_queue_t *bq);
+
+/**
+ * @brief This function pins the calling thread to the CPUs of the NUMA node that holds the bit queue buffer
+ * Call it from the consumer (or producer) thread so it accesses the buffer without crossing sockets.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or the node of the buffer has no CPUs
+ * 2) The errno is set by get_mempolicy, reading the node cpulist or sched_setaffinity
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * 
+ * @return int 0 in success or -1 in failure
+ */
+int bit_queue_numa_pin_thread(bit_queue_t *bq);
+
+/**
+ * @brief This function returns the eventfd that is readable while the queue holds at least read_watermark bits
+ * 
+ * Sets errno to EINVAL if bq = NULL or bq->buffer = NULL or the queue wasn't created with BIT_QUEUE_ATTR_EVENTFD
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * 
+ * @return int The eventfd or -1 in failure
+ */
+int bit_queue_read_fd(bit_queue_t *bq);
+
+/**
+ * @brief This function returns the eventfd that is readable while the queue has at least write_watermark free bits
+ * 
+ * Sets errno to EINVAL if bq = NULL or bq->buffer = NULL or the queue wasn't created with BIT_QUEUE_ATTR_EVENTFD
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * 
+ * @return int The eventfd or -1 in failure
+ */
+int bit_queue_write_fd(bit_queue_t *bq);
+
 /**
  * @brief This function copys bits from the bit queue buffer into the buffer
  * 
@@ -85,6 +273,106 @@ int bit_queue_read_bits(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, si
  */
 int bit_queue_write_bits(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, size_t bit_count);
 
+/**
+ * @brief This function copys the same bits from the buffer into several bit queues.
+ * The source is shifted once per distinct write bit offset of the queues and copied to each queue byte by byte.
+ * Either all of the queues are written or none of them.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if queues = NULL or count = 0 or buffer = NULL or bit_count = 0 or one of the queues is invalid
+ * 2) Sets errno to EMSGSIZE if the bit count is larger than one of the bit queue buffers
+ * 3) Sets errno to EAGAIN if one of the queues doesn't have enough space
+ * 4) The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param queues The destination bit queues, a queue must not appear twice
+ * @param count The number of queues
+ * @param buffer The source buffer
+ * @param buffer_size The size of the received buffer
+ * @param bit_count The amount of bits to write
+ * 
+ * @return int The number of bits written to each queue or -1 in failure
+ */
+int bit_queue_write_bits_multi(bit_queue_t **queues, size_t count, uint8_t *buffer, size_t buffer_size, size_t bit_count);
+
+/**
+ * @brief This function moves bits from one bit queue to another without an intermediate buffer
+ * The bits are copied directly between the two buffers, handling the wrap point and bit offset of each queue.
+ * The caller acts as the reader of src and the writer of dst.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if dst = NULL or src = NULL or dst = src or bit_count = 0 or one of the queues is invalid
+ * 2) Sets errno to EMSGSIZE if the bit count is larger than one of the bit queue buffers
+ * 3) Sets errno to EAGAIN if src doesn't hold enough data or dst doesn't have enough space
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param dst The destination bit queue
+ * @param src The source bit queue
+ * @param bit_count The amount of bits to move
+ * 
+ * @return int The number of bits moved or -1 in failure
+ */
+int bit_queue_transfer(bit_queue_t *dst, bit_queue_t *src, size_t bit_count);
+
+/**
+ * @brief This function copys bits from the bit queue buffer into the buffer, waiting for the data if needed
+ * The reader spins for a short adaptive period and then sleeps until the writer has written enough bits.
+ * 
+ * errno options:
+ * 1) The errno options of bit_queue_read_bits except EAGAIN
+ * 2) Sets errno to ETIMEDOUT if the data didn't arrive before the timeout expired
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The source bit queue
+ * @param buffer The destintion buffer
+ * @param buffer_size The size of the received buffer
+ * @param bit_count The amount of bits to read
+ * @param timeout The maximal time to wait or NULL to wait forever
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_bits_wait(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, size_t bit_count, const struct timespec *timeout);
+
+/**
+ * @brief This function copys bits from the buffer into the bit queue buffer, waiting for space if needed
+ * The writer spins for a short adaptive period and then sleeps until the reader has freed enough bits.
+ * 
+ * errno options:
+ * 1) The errno options of bit_queue_write_bits except EAGAIN
+ * 2) Sets errno to ETIMEDOUT if the space wasn't freed before the timeout expired
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The destination bit queue
+ * @param buffer The source buffer
+ * @param buffer_size The size of the received buffer
+ * @param bit_count The amount of bits to write
+ * @param timeout The maximal time to wait or NULL to wait forever
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_bits_wait(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, size_t bit_count, const struct timespec *timeout);
+
+/**
+ * @brief This function takes a snapshot of the statistics of the bit queue, it can be called from any thread.
+ * The counters are read one by one with relaxed loads so a snapshot taken during a call may mix before and after values.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or stats = NULL or bq->buffer = NULL
+ * 2) Sets errno to ENOTSUP if the library was built without BIT_QUEUE_STATS
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * @param stats Returns the snapshot
+ * 
+ * @return int 0 in success or -1 in failure
+ */
+int bit_queue_get_stats(bit_queue_t *bq, bit_queue_stats_t *stats);
+
 /**
  * @brief Destroyes the bit queue and frees allocated data
  * 
@@ -96,4 +384,8 @@ int bit_queue_write_bits(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, s
  */
 int bit_queue_destroy(bit_queue_t *bq);
 
-#endif /// BIT_QUEUE_H_
\ No newline at end of file
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_H_
\ No newline at end of file
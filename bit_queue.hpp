@@ -0,0 +1,212 @@
+/**
+ * @file bit_queue.hpp
+ * @author amitfr1
+ * @brief Header only C++ wrapper of the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_cpp
+ * The queue class owns a bit_queue_t and destroys it, it can be moved but not copied.
+ * read<N>() and write<N>(value) take the bit count as a template argument so the shifts and masks are constants:
+ * up to 32 bits they inline the fast path of bit_queue_inline.h on a 32 bit value and up to 64 bits its fast path on a
+ * 64 bit value, which merges one unaligned word and the byte after it with no loop. Values are the first bit read or written in the LSB, like the C functions.
+ * A full or empty queue is reported by the return value (false or an empty optional), any other failure throws
+ * std::system_error with the errno of the C function.
+ * Requires C++17, the caller must be compiled with the layout definitions of the library (see bit_queue_inline.h).
+ */
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include "bit_queue.h"
+#include "bit_queue_inline.h"
+
+#ifndef BIT_QUEUE_HPP_
+#define BIT_QUEUE_HPP_
+
+namespace bit_queue
+{
+
+static_assert(sizeof(std::atomic<size_t>) == sizeof(size_t) && std::atomic<size_t>::is_always_lock_free,
+              "the C++ view of the queue layout needs lock free atomics the size of their values");
+
+/**
+ * @brief The smallest unsigned type that holds N bits
+ * @ingroup bit_queue_cpp
+ */
+template <unsigned N>
+using uint_bits_t = std::conditional_t<(N <= 8), uint8_t,
+                    std::conditional_t<(N <= 16), uint16_t,
+                    std::conditional_t<(N <= 32), uint32_t, uint64_t>>>;
+
+/**
+ * @brief An owning handle of a bit queue
+ * @ingroup bit_queue_cpp
+ */
+class queue
+{
+public:
+    /**
+     * @brief This constructor allocates a queue of byte_count bytes (bit_queue_base_init)
+     * @throws std::system_error when bit_queue_base_init fails
+     */
+    explicit queue(size_t byte_count) : bq_(bit_queue_base_init(byte_count))
+    {
+        if (bq_ == nullptr)
+        {
+            throw std::system_error(errno, std::generic_category(), "bit_queue_base_init");
+        }
+    }
+
+    /**
+     * @brief This constructor takes the ownership of a queue created by the C functions, bq can be nullptr
+     */
+    explicit queue(bit_queue_t *bq) noexcept : bq_(bq)
+    {
+    }
+
+    queue(queue &&other) noexcept : bq_(std::exchange(other.bq_, nullptr))
+    {
+    }
+
+    queue &operator=(queue &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset(std::exchange(other.bq_, nullptr));
+        }
+        return *this;
+    }
+
+    queue(const queue &) = delete;
+    queue &operator=(const queue &) = delete;
+
+    ~queue()
+    {
+        reset();
+    }
+
+    /**
+     * @brief This function destroys the owned queue and takes the ownership of bq
+     */
+    void reset(bit_queue_t *bq = nullptr) noexcept
+    {
+        if (bq_ != nullptr)
+        {
+            bit_queue_destroy(bq_);
+        }
+        bq_ = bq;
+    }
+
+    /**
+     * @brief This function gives up the ownership of the queue and returns it
+     */
+    bit_queue_t *release() noexcept
+    {
+        return std::exchange(bq_, nullptr);
+    }
+
+    /**
+     * @brief The C handle for the functions the wrapper doesn't cover
+     */
+    bit_queue_t *get() const noexcept
+    {
+        return bq_;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return bq_ != nullptr;
+    }
+
+    /**
+     * @brief This function writes the N low bits of value
+     * @return true if the bits were written or false if the queue doesn't have the space
+     * @throws std::system_error when the write fails for any other reason
+     */
+    template <unsigned N>
+    bool write(uint_bits_t<N> value)
+    {
+        static_assert(N >= 1 && N <= 64, "a queue transfer is 1 - 64 bits");
+        int ret_val;
+        if constexpr (N <= BIT_QUEUE_INLINE_MAX_BITS)
+        {
+            ret_val = bit_queue_write_value(bq_, value, N);
+        }
+        else
+        {
+            ret_val = bit_queue_write_value64(bq_, value, N);
+        }
+        return check(ret_val, "bit_queue_write_bits");
+    }
+
+    /**
+     * @brief This function reads N bits
+     * @return The bits (the first one read in the LSB) or an empty optional if the queue doesn't hold N bits
+     * @throws std::system_error when the read fails for any other reason
+     */
+    template <unsigned N>
+    std::optional<uint_bits_t<N>> read()
+    {
+        static_assert(N >= 1 && N <= 64, "a queue transfer is 1 - 64 bits");
+        std::optional<uint_bits_t<N>> ret_val;
+        if constexpr (N <= BIT_QUEUE_INLINE_MAX_BITS)
+        {
+            uint32_t value;
+            if (check(bit_queue_read_value(bq_, &value, N), "bit_queue_read_bits"))
+            {
+                ret_val = static_cast<uint_bits_t<N>>(value);
+            }
+        }
+        else
+        {
+            uint64_t value;
+            if (check(bit_queue_read_value64(bq_, &value, N), "bit_queue_read_bits"))
+            {
+                ret_val = value;
+            }
+        }
+        return ret_val;
+    }
+
+    /**
+     * @brief This function writes bit_count bits of buffer (bit_queue_write_bits)
+     * @return true if the bits were written or false if the queue doesn't have the space
+     * @throws std::system_error when the write fails for any other reason
+     */
+    bool write_bits(uint8_t *buffer, size_t buffer_size, size_t bit_count)
+    {
+        return check(bit_queue_write_bits(bq_, buffer, buffer_size, bit_count), "bit_queue_write_bits");
+    }
+
+    /**
+     * @brief This function reads bit_count bits into buffer (bit_queue_read_bits)
+     * @return true if the bits were read or false if the queue doesn't hold bit_count bits
+     * @throws std::system_error when the read fails for any other reason
+     */
+    bool read_bits(uint8_t *buffer, size_t buffer_size, size_t bit_count)
+    {
+        return check(bit_queue_read_bits(bq_, buffer, buffer_size, bit_count), "bit_queue_read_bits");
+    }
+
+private:
+    /**
+     * @brief This function turns the result of a C call to true in success and false on EAGAIN and throws otherwise
+     */
+    static bool check(int ret_val, const char *what)
+    {
+        if (ret_val == -1 && errno != EAGAIN)
+        {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+        return ret_val != -1;
+    }
+
+    bit_queue_t *bq_; /// The owned queue or nullptr
+};
+
+} // namespace bit_queue
+
+#endif /// BIT_QUEUE_HPP_
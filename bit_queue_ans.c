@@ -0,0 +1,459 @@
+/**
+ * @file bit_queue_ans.c
+ * @author amitfr1
+ * @brief rANS entropy coding over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @ingroup bit_queue_ans
+ * 
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "bit_queue_ans.h"
+#include "bit_queue_internal.h"
+
+/**
+ * @brief The sum of the normalized frequencies
+ * @ingroup bit_queue_ans
+ */
+#define SCALE (1U << BIT_QUEUE_ANS_SCALE_BITS)
+
+/**
+ * @brief The number of bits in a renormalization word
+ * @ingroup bit_queue_ans
+ */
+#define WORD_BITS 16
+
+/**
+ * @brief The lower bound of a normalized state, the initial state of the encoder
+ * @ingroup bit_queue_ans
+ */
+#define STATE_LOW (1U << WORD_BITS)
+
+/**
+ * @brief The number of states decoded by one SIMD step
+ * @ingroup bit_queue_ans
+ */
+#define LANES 8
+
+/**
+ * @brief The number of zero words after the staged stream, a SIMD step loads LANES words past its position
+ * @ingroup bit_queue_ans
+ */
+#define STREAM_PAD LANES
+
+/**
+ * @brief The number of coded words kept on the stack by a read or a write, longer transfers allocate them
+ * @ingroup bit_queue_ans
+ */
+#define LOCAL_WORDS 4096
+
+/**
+ * @brief This define creates the decoding entry of a slot: the symbol, the frequency - 1 and the slot offset
+ * in the symbol range
+ * @ingroup bit_queue_ans
+ */
+#define SLOT_ENTRY(symbol, freq, bias) ((uint32_t)(symbol) | ((uint32_t)((freq) - 1) << 8) | ((uint32_t)(bias) << 20))
+
+/**
+ * @brief This stuct holds a static rANS model
+ * @ingroup bit_queue_ans
+ */
+struct _bit_queue_ans_t
+{
+    size_t symbol_count; /// The number of symbols
+    uint32_t freq[BIT_QUEUE_ANS_MAX_SYMBOLS]; /// The normalized frequency of every symbol
+    uint32_t cum[BIT_QUEUE_ANS_MAX_SYMBOLS]; /// The sum of the normalized frequencies of the previous symbols
+    uint32_t slots[SCALE]; /// The decoding entry of every slot of a state
+    uint8_t refill[1 << LANES][LANES]; /// The index of the stream word of every lane by the lanes that renormalize
+};
+
+/**
+ * @brief This function normalizes the counts to frequencies that sum to SCALE
+ * 
+ * @ingroup bit_queue_ans
+ * 
+ * @param ans The model
+ * @param counts The counts of the symbols
+ * @param total The sum of the counts
+ */
+static void bit_queue_ans_normalize(bit_queue_ans_t *ans, const uint32_t *counts, uint64_t total);
+
+/**
+ * @brief This function copies the coded words at the read cursor into a contiguous stream without consuming them
+ * 
+ * @ingroup bit_queue_ans
+ * 
+ * @param bq The source bit queue
+ * @param stream Returns the words
+ * @param max_words The largest number of words to copy
+ * @return size_t The number of words copied
+ */
+static size_t bit_queue_ans_stage(bit_queue_t *bq, uint16_t *stream, size_t max_words);
+
+/**
+ * @brief This function decodes the symbols of the states in order, one state at a time
+ * 
+ * @ingroup bit_queue_ans
+ * 
+ * @param ans The model
+ * @param states The states
+ * @param streams The number of states
+ * @param symbols Returns the symbols
+ * @param count The number of symbols
+ * @param stream The words
+ * @param pos The position of the next word, advanced past the words read
+ */
+static void bit_queue_ans_decode(const bit_queue_ans_t *ans, uint32_t *states, size_t streams, uint8_t *symbols, size_t count,
+                                 const uint16_t *stream, size_t *pos);
+
+#ifdef __AVX2__
+/**
+ * @brief This function decodes whole rounds of symbols, LANES states per step.
+ * The lanes that renormalize take the next stream words in lane order, matching the scalar decoder.
+ * 
+ * @ingroup bit_queue_ans
+ * 
+ * @param ans The model
+ * @param states The states, streams is a multiple of LANES
+ * @param streams The number of states
+ * @param symbols Returns the symbols
+ * @param rounds The number of rounds (streams symbols each) to decode
+ * @param stream The words, STREAM_PAD words past the end are readable
+ * @param words The number of words in the stream
+ * @param pos The position of the next word, advanced past the words read
+ * @return size_t The number of rounds decoded before the stream ran out
+ */
+static size_t bit_queue_ans_decode_avx2(const bit_queue_ans_t *ans, uint32_t *states, size_t streams, uint8_t *symbols,
+                                        size_t rounds, const uint16_t *stream, size_t words, size_t *pos);
+#endif
+
+bit_queue_ans_t * bit_queue_ans_init(const uint32_t *counts, size_t symbol_count)
+{
+    bit_queue_ans_t * ans = NULL;
+    uint64_t total = 0;
+    size_t i;
+    size_t j;
+    uint8_t k;
+    for (i = 0; counts != NULL && i < symbol_count && i < BIT_QUEUE_ANS_MAX_SYMBOLS; i++)
+    {
+        total += counts[i];
+    }
+    if (counts == NULL || symbol_count == 0 || symbol_count > BIT_QUEUE_ANS_MAX_SYMBOLS || total == 0)
+    {
+        errno = EINVAL;
+    }
+    else if (!(ans = calloc(1, sizeof(*ans))))
+    {
+        // errno is set by calloc
+    }
+    else
+    {
+        ans->symbol_count = symbol_count;
+        bit_queue_ans_normalize(ans, counts, total);
+        for (i = 0; i < symbol_count; i++)
+        {
+            for (j = 0; j < ans->freq[i]; j++)
+            {
+                ans->slots[ans->cum[i] + j] = SLOT_ENTRY(i, ans->freq[i], j);
+            }
+        }
+        for (i = 0; i < 1 << LANES; i++)
+        {
+            // a renormalizing lane takes the word after the ones of the lower renormalizing lanes
+            for (j = 0, k = 0; j < LANES; j++)
+            {
+                ans->refill[i][j] = k;
+                k += (i >> j) & 1;
+            }
+        }
+    }
+    return ans;
+}
+
+int bit_queue_write_ans(bit_queue_t *bq, const bit_queue_ans_t *ans, const uint8_t *symbols, size_t count, size_t streams)
+{
+    int ret_val = -1;
+    uint32_t states[BIT_QUEUE_ANS_MAX_STREAMS];
+    uint16_t local_stack[LOCAL_WORDS];
+    uint16_t * stack = local_stack;
+    uint64_t word;
+    uint32_t freq;
+    uint32_t x;
+    size_t top = 0;
+    size_t i;
+    size_t j;
+    if (bq == NULL || bq->buffer == NULL || ans == NULL || symbols == NULL || count == 0 || streams == 0 ||
+        streams > BIT_QUEUE_ANS_MAX_STREAMS)
+    {
+        errno = EINVAL;
+    }
+    else if (count + 2 * streams > LOCAL_WORDS && !(stack = malloc((count + 2 * streams) * sizeof(*stack))))
+    {
+        // errno is set by malloc
+    }
+    else
+    {
+        for (i = 0; i < streams; i++)
+        {
+            states[i] = STATE_LOW;
+        }
+        // the encoder runs backwards so the decoder reads the words forwards, the words are stacked and written reversed
+        for (i = count; i-- > 0 && (freq = symbols[i] < ans->symbol_count ? ans->freq[symbols[i]] : 0);)
+        {
+            x = states[i % streams];
+            // the bound is 1 << 32 when a symbol has the whole scale so it's computed in 64 bits
+            if (x >= ((uint64_t)(STATE_LOW >> BIT_QUEUE_ANS_SCALE_BITS) << WORD_BITS) * freq)
+            {
+                stack[top++] = x & UINT16_MAX;
+                x >>= WORD_BITS;
+            }
+            states[i % streams] = ((x / freq) << BIT_QUEUE_ANS_SCALE_BITS) + (x % freq) + ans->cum[symbols[i]];
+        }
+        for (j = streams; j-- > 0;)
+        {
+            stack[top++] = states[j] >> WORD_BITS;
+            stack[top++] = states[j] & UINT16_MAX;
+        }
+        if (i != SIZE_MAX)
+        {
+            errno = ERANGE;
+        }
+        else if (top * WORD_BITS > bq->buffer_size * BITS_IN_BYTE || top * WORD_BITS > INT_MAX)
+        {
+            errno = EMSGSIZE;
+        }
+        else if (!bit_queue_has_space(bq, top * WORD_BITS))
+        {
+            errno = EAGAIN;
+        }
+        else
+        {
+            for (i = top; i > 0; i -= j)
+            {
+                for (j = 0, word = 0; j < WINDOW_BITS / WORD_BITS && j < i; j++)
+                {
+                    word |= (uint64_t)stack[i - 1 - j] << (j * WORD_BITS);
+                }
+                bit_queue_put_bits(bq, word, j * WORD_BITS);
+            }
+            bit_queue_publish_write(bq, top * WORD_BITS);
+            ret_val = top * WORD_BITS;
+        }
+        if (stack != local_stack)
+        {
+            free(stack);
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_read_ans(bit_queue_t *bq, const bit_queue_ans_t *ans, uint8_t *symbols, size_t count, size_t streams)
+{
+    int ret_val = -1;
+    uint32_t states[BIT_QUEUE_ANS_MAX_STREAMS];
+    uint16_t local_stream[LOCAL_WORDS];
+    uint16_t * stream = local_stream;
+    size_t words = 0;
+    size_t pos = 0;
+    size_t done = 0;
+    size_t i;
+    if (bq == NULL || bq->buffer == NULL || ans == NULL || symbols == NULL || count == 0 || streams == 0 ||
+        streams > BIT_QUEUE_ANS_MAX_STREAMS)
+    {
+        errno = EINVAL;
+    }
+    else if (count + 2 * streams + STREAM_PAD > LOCAL_WORDS && !(stream = malloc((count + 2 * streams + STREAM_PAD) * sizeof(*stream))))
+    {
+        // errno is set by malloc
+    }
+    else if ((words = bit_queue_ans_stage(bq, stream, count + 2 * streams)) < 2 * streams)
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        // the words past the staged ones read as zeros, a decoder that reaches them finds the stream too short
+        memset(stream + words, 0, (count + 2 * streams + STREAM_PAD - words) * sizeof(*stream));
+        for (i = 0; i < streams; i++, pos += 2)
+        {
+            states[i] = stream[pos] | ((uint32_t)stream[pos + 1] << WORD_BITS);
+        }
+#ifdef __AVX2__
+        if (!(streams % LANES))
+        {
+            done = bit_queue_ans_decode_avx2(ans, states, streams, symbols, count / streams, stream, words, &pos) * streams;
+        }
+#endif
+        bit_queue_ans_decode(ans, states, streams, symbols + done, count - done, stream, &pos);
+        for (i = 0; i < streams && states[i] == STATE_LOW; i++)
+        {
+        }
+        if (pos > words)
+        {
+            // the decoder ran into the zero padding past the staged words
+            errno = EAGAIN;
+        }
+        else if (i < streams)
+        {
+            errno = EBADMSG;
+        }
+        else
+        {
+            bit_queue_advance_read(bq, pos * WORD_BITS);
+            bit_queue_publish_read(bq, pos * WORD_BITS);
+            ret_val = pos * WORD_BITS;
+        }
+    }
+    if (stream != local_stream)
+    {
+        free(stream);
+    }
+    return ret_val;
+}
+
+int bit_queue_ans_destroy(bit_queue_ans_t *ans)
+{
+    int ret_val = -1;
+    if (ans == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        free(ans);
+        ret_val = 0;
+    }
+    return ret_val;
+}
+
+// static functions
+
+static void bit_queue_ans_normalize(bit_queue_ans_t *ans, const uint32_t *counts, uint64_t total)
+{
+    uint32_t sum = 0;
+    size_t largest = 0;
+    size_t i;
+    for (i = 0; i < ans->symbol_count; i++)
+    {
+        ans->freq[i] = counts[i] ? counts[i] * (uint64_t)SCALE / total : 0;
+        ans->freq[i] += counts[i] && !ans->freq[i];
+        sum += ans->freq[i];
+        largest = ans->freq[i] > ans->freq[largest] ? i : largest;
+    }
+    // the rounding error goes to the largest frequency, an excess from the frequencies rounded up to 1 is taken
+    // from the largest frequencies one at a time
+    while (sum > SCALE)
+    {
+        for (i = 0; i < ans->symbol_count; i++)
+        {
+            largest = ans->freq[i] > ans->freq[largest] ? i : largest;
+        }
+        ans->freq[largest]--;
+        sum--;
+    }
+    ans->freq[largest] += SCALE - sum;
+    for (i = 1; i < ans->symbol_count; i++)
+    {
+        ans->cum[i] = ans->cum[i - 1] + ans->freq[i - 1];
+    }
+}
+
+static size_t bit_queue_ans_stage(bit_queue_t *bq, uint16_t *stream, size_t max_words)
+{
+    uint64_t window;
+    size_t words;
+    size_t i;
+    size_t j;
+    bit_queue_has_data(bq, max_words * WORD_BITS);
+    words = (bq->w_count_cache - BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed)) / WORD_BITS;
+    words = words < max_words ? words : max_words;
+    for (i = 0; i < words; i += WINDOW_BITS / WORD_BITS)
+    {
+        bit_queue_peek_bits(bq, i * WORD_BITS, &window);
+        for (j = 0; j < WINDOW_BITS / WORD_BITS && i + j < words; j++)
+        {
+            stream[i + j] = window >> (j * WORD_BITS);
+        }
+    }
+    return words;
+}
+
+static void bit_queue_ans_decode(const bit_queue_ans_t *ans, uint32_t *states, size_t streams, uint8_t *symbols, size_t count,
+                                 const uint16_t *stream, size_t *pos)
+{
+    uint32_t entry;
+    uint32_t x;
+    size_t next = *pos;
+    size_t i;
+    size_t s;
+    for (i = 0; i < count; i += streams)
+    {
+        // the states of a round are independent so their decodes overlap
+        for (s = 0; s < streams && i + s < count; s++)
+        {
+            x = states[s];
+            entry = ans->slots[x & (SCALE - 1)];
+            symbols[i + s] = entry & BYTE_MASK;
+            x = (((entry >> 8) & (SCALE - 1)) + 1) * (x >> BIT_QUEUE_ANS_SCALE_BITS) + (entry >> 20);
+            if (x < STATE_LOW)
+            {
+                x = (x << WORD_BITS) | stream[next++];
+            }
+            states[s] = x;
+        }
+    }
+    *pos = next;
+}
+
+#ifdef __AVX2__
+static size_t bit_queue_ans_decode_avx2(const bit_queue_ans_t *ans, uint32_t *states, size_t streams, uint8_t *symbols,
+                                        size_t rounds, const uint16_t *stream, size_t words, size_t *pos)
+{
+    const __m256i slot_mask = _mm256_set1_epi32(SCALE - 1);
+    const __m256i freq_mask = _mm256_set1_epi32(SCALE - 1);
+    const __m256i one = _mm256_set1_epi32(1);
+    uint32_t lanes[LANES];
+    __m256i x;
+    __m256i entry;
+    __m256i low;
+    __m256i refill;
+    size_t next = *pos;
+    size_t r;
+    size_t s;
+    size_t i;
+    int mask;
+    for (r = 0; r < rounds && next <= words; r++)
+    {
+        for (s = 0; s < streams; s += LANES)
+        {
+            x = _mm256_loadu_si256((const __m256i *)(states + s));
+            entry = _mm256_i32gather_epi32((const int *)ans->slots, _mm256_and_si256(x, slot_mask), 4);
+            _mm256_storeu_si256((__m256i *)lanes, entry);
+            for (i = 0; i < LANES; i++)
+            {
+                symbols[r * streams + s + i] = lanes[i];
+            }
+            x = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(entry, 8), freq_mask), one),
+                                                    _mm256_srli_epi32(x, BIT_QUEUE_ANS_SCALE_BITS)),
+                                 _mm256_srli_epi32(entry, 20));
+            // the lanes below STATE_LOW shift in the next words of the stream in lane order
+            low = _mm256_cmpeq_epi32(_mm256_srli_epi32(x, WORD_BITS), _mm256_setzero_si256());
+            mask = _mm256_movemask_ps(_mm256_castsi256_ps(low));
+            refill = _mm256_permutevar8x32_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(stream + next))),
+                                                 _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)ans->refill[mask])));
+            x = _mm256_blendv_epi8(x, _mm256_or_si256(_mm256_slli_epi32(x, WORD_BITS), refill), low);
+            next += __builtin_popcount(mask);
+            _mm256_storeu_si256((__m256i *)(states + s), x);
+        }
+    }
+    *pos = next;
+    return r;
+}
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file bit_queue_ans.h
+ * @author amitfr1
+ * @brief rANS entropy coding over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_ans
+ * This module compresses arrays of byte symbols with a static range asymmetric numeral systems (rANS) coder and
+ * uses the bit queue as its bitstream.
+ * The symbol frequencies are normalized to 1 << BIT_QUEUE_ANS_SCALE_BITS. The coder keeps 32 bit states that are
+ * renormalized 16 bits at a time, symbol i of an array is coded by state i % streams and all of the states share one
+ * stream of 16 bit words, so the states decode independently of each other (in parallel SIMD lanes when available).
+ * A coded array is the final encoder states (32 bits each) followed by the renormalization words in decoding order.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "bit_queue.h"
+
+#ifndef BIT_QUEUE_ANS_H_
+#define BIT_QUEUE_ANS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The number of bits of the normalized frequencies
+ * @ingroup bit_queue_ans
+ */
+#define BIT_QUEUE_ANS_SCALE_BITS 12
+
+/**
+ * @brief The largest number of symbols in a model
+ * @ingroup bit_queue_ans
+ */
+#define BIT_QUEUE_ANS_MAX_SYMBOLS 256
+
+/**
+ * @brief The largest number of interleaved states
+ * @ingroup bit_queue_ans
+ */
+#define BIT_QUEUE_ANS_MAX_STREAMS 32
+
+typedef struct _bit_queue_ans_t bit_queue_ans_t;
+
+/**
+ * @brief This function creates a static model from symbol counts.
+ * Every symbol with a count gets a normalized frequency of at least 1.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if counts = NULL or symbol_count = 0 or symbol_count > BIT_QUEUE_ANS_MAX_SYMBOLS or
+ *    all of the counts are 0
+ * 2) The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue_ans
+ * 
+ * @param counts The number of occurrences of every symbol
+ * @param symbol_count The number of symbols
+ * 
+ * @return bit_queue_ans_t* Address of the created model or NULL in failure
+ */
+bit_queue_ans_t * bit_queue_ans_init(const uint32_t *counts, size_t symbol_count);
+
+/**
+ * @brief This function codes an array of symbols into the bit queue.
+ * Either the whole array is written or nothing.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or ans = NULL or symbols = NULL or count = 0 or
+ *    streams isn't in the range 1 - BIT_QUEUE_ANS_MAX_STREAMS
+ * 2) Sets errno ERANGE if a symbol has a frequency of 0
+ * 3) Sets errno to EMSGSIZE if the coded array is larger than the entire bit queue buffer
+ * 4) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 5) The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue_ans
+ * 
+ * @param bq The destination bit queue
+ * @param ans The model
+ * @param symbols The symbols to write
+ * @param count The number of symbols
+ * @param streams The number of interleaved states
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_ans(bit_queue_t *bq, const bit_queue_ans_t *ans, const uint8_t *symbols, size_t count, size_t streams);
+
+/**
+ * @brief This function decodes an array of symbols from the bit queue.
+ * The count and the streams must match the ones given to bit_queue_write_ans.
+ * Either the whole array is read or nothing.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or ans = NULL or symbols = NULL or count = 0 or
+ *    streams isn't in the range 1 - BIT_QUEUE_ANS_MAX_STREAMS
+ * 2) Sets errno EBADMSG if the final states don't match the initial encoder states (the stream is corrupted)
+ * 3) Sets errno to EAGAIN if the queue doesn't hold the whole coded array
+ * 4) The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue_ans
+ * 
+ * @param bq The source bit queue
+ * @param ans The model
+ * @param symbols Returns the symbols read
+ * @param count The number of symbols
+ * @param streams The number of interleaved states
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_ans(bit_queue_t *bq, const bit_queue_ans_t *ans, uint8_t *symbols, size_t count, size_t streams);
+
+/**
+ * @brief This function frees the model
+ * 
+ * Sets errno EINVAL if ans = NULL
+ * 
+ * @ingroup bit_queue_ans
+ * 
+ * @param ans The model
+ * 
+ * @return int 0 in success or -1 in failure
+ */
+int bit_queue_ans_destroy(bit_queue_ans_t *ans);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_ANS_H_
@@ -0,0 +1,473 @@
+/**
+ * @file bit_queue_golomb.c
+ * @author amitfr1
+ * @brief Exp-Golomb codes over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include "bit_queue_golomb.h"
+#include "bit_queue_internal.h"
+
+/**
+ * @brief The longest prefix of a valid ue(v) code
+ * @ingroup bit_queue_golomb
+ */
+#define UE_MAX_PREFIX 31
+
+/**
+ * @brief The number of bits of the k header of a Golomb-Rice block
+ * @ingroup bit_queue_golomb
+ */
+#define RICE_K_BITS 5
+
+/**
+ * @brief The length of an escaped Golomb-Rice code
+ * @ingroup bit_queue_golomb
+ */
+#define RICE_ESCAPE_BITS (BIT_QUEUE_RICE_ESCAPE + 32)
+
+/**
+ * @brief The number of block parameters of a Golomb-Rice coded array kept on the stack, longer arrays allocate them
+ * @ingroup bit_queue_golomb
+ */
+#define RICE_LOCAL_BLOCKS 64
+
+/**
+ * @brief This function reverses the order of the low bits of a value, the info bits of a ue(v) code are sent MSB first
+ * while the queue carries the first bit in the LSB
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bits The bits to reverse
+ * @param count The number of low bits to reverse (0 - 32)
+ * @return uint32_t The reversed bits
+ */
+static inline uint32_t bit_queue_golomb_reverse(uint32_t bits, size_t count);
+
+/**
+ * @brief This function creates the Golomb-Rice code of a value
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param value The value
+ * @param k The Golomb-Rice parameter
+ * @param code Returns the code, the first bit in the LSB
+ * @return size_t The length of the code
+ */
+static inline size_t bit_queue_rice_code(uint32_t value, uint8_t k, uint64_t *code);
+
+/**
+ * @brief This function decodes the Golomb-Rice code in the low bits of a window
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param window The next bits of the queue, the bits past the valid ones are zero
+ * @param k The Golomb-Rice parameter
+ * @param value Returns the decoded value
+ * @return size_t The length of the code, the code is valid only if the window holds that many bits
+ */
+static inline size_t bit_queue_rice_decode(uint64_t window, uint8_t k, uint32_t *value);
+
+/**
+ * @brief This function chooses the k that gives the shortest block
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param values The values of the block
+ * @param count The number of values in the block
+ * @param bits Returns the number of bits of the block codes with the chosen k (without the header)
+ * @return uint8_t The chosen k
+ */
+static uint8_t bit_queue_rice_block_k(const uint32_t *values, size_t count, size_t *bits);
+
+/**
+ * @brief This function chooses the k of every Golomb-Rice block of an array and sums the size of the blocks
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param values The values
+ * @param count The number of values
+ * @param ks Returns the k of every block
+ * @return size_t The number of bits of the blocks
+ */
+static size_t bit_queue_rice_size(const uint32_t *values, size_t count, uint8_t *ks);
+
+/**
+ * @brief This function decodes Golomb-Rice blocks at the read cursor without consuming them
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bq The source bit queue
+ * @param values Returns the decoded values
+ * @param count The number of values
+ * @param used Returns the number of bits decoded
+ * @return size_t The number of values decoded before the queue ran short of a whole code
+ */
+static size_t bit_queue_rice_scan(bit_queue_t *bq, uint32_t *values, size_t count, size_t *used);
+
+int bit_queue_write_ue(bit_queue_t *bq, uint32_t value)
+{
+    int ret_val = -1;
+    uint64_t code;
+    size_t prefix;
+    if (bq == NULL || bq->buffer == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if (value > BIT_QUEUE_UE_MAX)
+    {
+        errno = ERANGE;
+    }
+    else
+    {
+        code = (uint64_t)value + 1;
+        prefix = WINDOW_BITS - 1 - __builtin_clzll(code);
+        // a code longer than the whole buffer would never fit
+        if (2 * prefix + 1 > bq->buffer_size * BITS_IN_BYTE)
+        {
+            errno = EMSGSIZE;
+        }
+        else if (!bit_queue_has_space(bq, 2 * prefix + 1))
+        {
+            errno = EAGAIN;
+        }
+        else
+        {
+            // the zero prefix, the marker bit (the MSB of the code) and then the low bits of the code MSB first
+            bit_queue_put_bits(bq, (1ULL << prefix) | ((uint64_t)bit_queue_golomb_reverse(code, prefix) << (prefix + 1)), 2 * prefix + 1);
+            bit_queue_publish_write(bq, 2 * prefix + 1);
+            ret_val = 2 * prefix + 1;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_write_se(bit_queue_t *bq, int32_t value)
+{
+    int ret_val = -1;
+    if (value == INT32_MIN)
+    {
+        errno = ERANGE;
+    }
+    else
+    {
+        ret_val = bit_queue_write_ue(bq, value > 0 ? 2 * (uint32_t)value - 1 : 2 * (uint32_t)-value);
+    }
+    return ret_val;
+}
+
+int bit_queue_read_ue(bit_queue_t *bq, uint32_t *value)
+{
+    int ret_val = -1;
+    uint64_t window;
+    size_t avail;
+    size_t prefix;
+    if (bq == NULL || bq->buffer == NULL || value == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if (!(avail = bit_queue_peek_bits(bq, 0, &window)))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        // the bits past avail are zero so a missing marker counts avail zeros
+        prefix = window ? (size_t)__builtin_ctzll(window) : avail;
+        if (prefix > UE_MAX_PREFIX)
+        {
+            errno = EBADMSG;
+        }
+        else if (2 * prefix + 1 > avail)
+        {
+            errno = EAGAIN;
+        }
+        else
+        {
+            *value = ((1ULL << prefix) | bit_queue_golomb_reverse(window >> (prefix + 1), prefix)) - 1;
+            bit_queue_advance_read(bq, 2 * prefix + 1);
+            bit_queue_publish_read(bq, 2 * prefix + 1);
+            ret_val = 2 * prefix + 1;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_read_se(bit_queue_t *bq, int32_t *value)
+{
+    int ret_val = -1;
+    uint32_t code;
+    if (value == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if ((ret_val = bit_queue_read_ue(bq, &code)) != -1)
+    {
+        *value = code & 1 ? (int32_t)(code / 2 + 1) : -(int32_t)(code / 2);
+    }
+    return ret_val;
+}
+
+int bit_queue_write_rice(bit_queue_t *bq, uint32_t value, uint8_t k)
+{
+    int ret_val = -1;
+    uint64_t code;
+    size_t length;
+    if (bq == NULL || bq->buffer == NULL || k > BIT_QUEUE_RICE_MAX_K)
+    {
+        errno = EINVAL;
+    }
+    // a code longer than the whole buffer would never fit
+    else if ((length = bit_queue_rice_code(value, k, &code)) > bq->buffer_size * BITS_IN_BYTE)
+    {
+        errno = EMSGSIZE;
+    }
+    else if (!bit_queue_has_space(bq, length))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        bit_queue_put_bits(bq, code, length);
+        bit_queue_publish_write(bq, length);
+        ret_val = length;
+    }
+    return ret_val;
+}
+
+int bit_queue_read_rice(bit_queue_t *bq, uint32_t *value, uint8_t k)
+{
+    int ret_val = -1;
+    uint64_t window;
+    size_t avail;
+    size_t length;
+    if (bq == NULL || bq->buffer == NULL || value == NULL || k > BIT_QUEUE_RICE_MAX_K)
+    {
+        errno = EINVAL;
+    }
+    else if ((avail = bit_queue_peek_bits(bq, 0, &window)) < (length = bit_queue_rice_decode(window, k, value)))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        bit_queue_advance_read(bq, length);
+        bit_queue_publish_read(bq, length);
+        ret_val = length;
+    }
+    return ret_val;
+}
+
+int bit_queue_write_rice_u32(bit_queue_t *bq, const uint32_t *values, size_t count)
+{
+    int ret_val = -1;
+    uint8_t local_ks[RICE_LOCAL_BLOCKS];
+    uint8_t * ks = local_ks;
+    uint64_t code;
+    size_t total;
+    size_t bits;
+    size_t block;
+    size_t n;
+    size_t i;
+    if (bq == NULL || bq->buffer == NULL || values == NULL || count == 0)
+    {
+        errno = EINVAL;
+    }
+    else if ((count + BIT_QUEUE_RICE_BLOCK - 1) / BIT_QUEUE_RICE_BLOCK > RICE_LOCAL_BLOCKS &&
+             !(ks = malloc((count + BIT_QUEUE_RICE_BLOCK - 1) / BIT_QUEUE_RICE_BLOCK)))
+    {
+        // errno is set by malloc
+    }
+    // the blocks are sized first so either all of them are written or none, the k of every block is kept for the writing
+    else if ((total = bit_queue_rice_size(values, count, ks)) > bq->buffer_size * BITS_IN_BYTE || total > INT_MAX)
+    {
+        errno = EMSGSIZE;
+    }
+    else if (!bit_queue_has_space(bq, total))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        for (block = 0; block < count; block += BIT_QUEUE_RICE_BLOCK)
+        {
+            n = count - block < BIT_QUEUE_RICE_BLOCK ? count - block : BIT_QUEUE_RICE_BLOCK;
+            bit_queue_put_bits(bq, ks[block / BIT_QUEUE_RICE_BLOCK], RICE_K_BITS);
+            for (i = 0; i < n; i++)
+            {
+                bits = bit_queue_rice_code(values[block + i], ks[block / BIT_QUEUE_RICE_BLOCK], &code);
+                bit_queue_put_bits(bq, code, bits);
+            }
+        }
+        bit_queue_publish_write(bq, total);
+        ret_val = total;
+    }
+    if (ks != local_ks)
+    {
+        free(ks);
+    }
+    return ret_val;
+}
+
+int bit_queue_read_rice_u32(bit_queue_t *bq, uint32_t *values, size_t count)
+{
+    int ret_val = -1;
+    size_t used;
+    if (bq == NULL || bq->buffer == NULL || values == NULL || count == 0)
+    {
+        errno = EINVAL;
+    }
+    else if (bit_queue_rice_scan(bq, values, count, &used) < count)
+    {
+        errno = EAGAIN;
+    }
+    else if (used > INT_MAX)
+    {
+        errno = EMSGSIZE;
+    }
+    else
+    {
+        bit_queue_advance_read(bq, used);
+        bit_queue_publish_read(bq, used);
+        ret_val = used;
+    }
+    return ret_val;
+}
+
+// static functions
+
+static inline uint32_t bit_queue_golomb_reverse(uint32_t bits, size_t count)
+{
+    // swap the halves, the bytes, the nibbles, the pairs and the bits and then drop the bits above count
+    bits = bits >> 16 | bits << 16;
+    bits = (bits >> 8 & 0x00ff00ff) | (bits & 0x00ff00ff) << 8;
+    bits = (bits >> 4 & 0x0f0f0f0f) | (bits & 0x0f0f0f0f) << 4;
+    bits = (bits >> 2 & 0x33333333) | (bits & 0x33333333) << 2;
+    bits = (bits >> 1 & 0x55555555) | (bits & 0x55555555) << 1;
+    return (uint64_t)bits >> (32 - count);
+}
+
+static inline size_t bit_queue_rice_code(uint32_t value, uint8_t k, uint64_t *code)
+{
+    size_t ret_val;
+    uint32_t quotient = value >> k;
+    if (quotient < BIT_QUEUE_RICE_ESCAPE)
+    {
+        // the zero prefix, the marker bit and then the k low bits
+        *code = (1ULL << quotient) | ((uint64_t)(value & ((1ULL << k) - 1)) << (quotient + 1));
+        ret_val = quotient + 1 + k;
+    }
+    else
+    {
+        *code = (uint64_t)value << BIT_QUEUE_RICE_ESCAPE;
+        ret_val = RICE_ESCAPE_BITS;
+    }
+    return ret_val;
+}
+
+static inline size_t bit_queue_rice_decode(uint64_t window, uint8_t k, uint32_t *value)
+{
+    size_t ret_val;
+    size_t prefix = window ? (size_t)__builtin_ctzll(window) : WINDOW_BITS;
+    if (prefix < BIT_QUEUE_RICE_ESCAPE)
+    {
+        *value = (prefix << k) | ((window >> (prefix + 1)) & ((1ULL << k) - 1));
+        ret_val = prefix + 1 + k;
+    }
+    else
+    {
+        *value = window >> BIT_QUEUE_RICE_ESCAPE;
+        ret_val = RICE_ESCAPE_BITS;
+    }
+    return ret_val;
+}
+
+static uint8_t bit_queue_rice_block_k(const uint32_t *values, size_t count, size_t *bits)
+{
+    uint64_t sum = 0;
+    uint32_t quotient;
+    size_t cost;
+    size_t i;
+    uint8_t k;
+    uint8_t best = 0;
+    uint8_t first;
+    for (i = 0; i < count; i++)
+    {
+        sum += values[i];
+    }
+    // the best k of a geometric source is close to log2 of the mean, try its neighbours too
+    sum /= count;
+    first = sum > 1 ? WINDOW_BITS - 1 - __builtin_clzll(sum) : 1;
+    first = first <= BIT_QUEUE_RICE_MAX_K ? first : BIT_QUEUE_RICE_MAX_K;
+    *bits = SIZE_MAX;
+    for (k = first - 1; k <= first + 1 && k <= BIT_QUEUE_RICE_MAX_K; k++)
+    {
+        for (i = 0, cost = 0; i < count; i++)
+        {
+            quotient = values[i] >> k;
+            cost += quotient < BIT_QUEUE_RICE_ESCAPE ? quotient + 1 + k : RICE_ESCAPE_BITS;
+        }
+        if (cost < *bits)
+        {
+            *bits = cost;
+            best = k;
+        }
+    }
+    return best;
+}
+
+static size_t bit_queue_rice_size(const uint32_t *values, size_t count, uint8_t *ks)
+{
+    size_t total = 0;
+    size_t bits;
+    size_t block;
+    for (block = 0; block < count; block += BIT_QUEUE_RICE_BLOCK)
+    {
+        ks[block / BIT_QUEUE_RICE_BLOCK] = bit_queue_rice_block_k(values + block, count - block < BIT_QUEUE_RICE_BLOCK ? count - block : BIT_QUEUE_RICE_BLOCK, &bits);
+        total += RICE_K_BITS + bits;
+    }
+    return total;
+}
+
+static size_t bit_queue_rice_scan(bit_queue_t *bq, uint32_t *values, size_t count, size_t *used)
+{
+    uint64_t window = 0;
+    size_t avail = 0;
+    size_t length;
+    size_t i;
+    uint8_t k = 0;
+    *used = 0;
+    for (i = 0; i < count; i++)
+    {
+        // a block starts with its k, the codes are decoded from the window until it runs short of a whole code
+        if (!(i % BIT_QUEUE_RICE_BLOCK))
+        {
+            if (avail < RICE_K_BITS && (avail = bit_queue_peek_bits(bq, *used, &window)) < RICE_K_BITS)
+            {
+                break;
+            }
+            k = window & ((1 << RICE_K_BITS) - 1);
+            window >>= RICE_K_BITS;
+            avail -= RICE_K_BITS;
+            *used += RICE_K_BITS;
+        }
+        if ((length = bit_queue_rice_decode(window, k, &values[i])) > avail)
+        {
+            avail = bit_queue_peek_bits(bq, *used, &window);
+            if ((length = bit_queue_rice_decode(window, k, &values[i])) > avail)
+            {
+                break;
+            }
+        }
+        window = length < WINDOW_BITS ? window >> length : 0;
+        avail -= length;
+        *used += length;
+    }
+    return i;
+}
@@ -0,0 +1,205 @@
+/**
+ * @file bit_queue_golomb.h
+ * @author amitfr1
+ * @brief Exp-Golomb codes over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_golomb
+ * This module reads and writes Exp-Golomb codes (ue(v) / se(v)) directly on the bit queue buffer.
+ * A code of value v is made of n zero bits, a one bit and the n low bits of v + 1 MSB first where n = floor(log2(v + 1)),
+ * as in H.264 (00101 is 4 and 00110 is 5). The first bit of the code is the first bit read from the queue, so the
+ * prefix is decoded with a single count trailing zeros on a 64 bit window of the queue and the info bits are bit
+ * reversed on the way in and out.
+ * 
+ * The module also codes Golomb-Rice codes with a parameter k: the quotient v >> k in unary (q zero bits and a one bit)
+ * followed by the k low bits of v. A quotient of BIT_QUEUE_RICE_ESCAPE or more is coded as BIT_QUEUE_RICE_ESCAPE zero
+ * bits followed by the 32 bits of v, so every code fits a 64 bit window.
+ * Arrays are coded in blocks of BIT_QUEUE_RICE_BLOCK values, each block starts with its k in 5 bits and k is chosen
+ * per block to give the shortest block.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "bit_queue.h"
+
+#ifndef BIT_QUEUE_GOLOMB_H_
+#define BIT_QUEUE_GOLOMB_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The largest value that can be coded as ue(v) (its code is 63 bits long)
+ * @ingroup bit_queue_golomb
+ */
+#define BIT_QUEUE_UE_MAX (UINT32_MAX - 1)
+
+/**
+ * @brief This function writes an unsigned Exp-Golomb code ue(v)
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL
+ * 2) Sets errno ERANGE if value > BIT_QUEUE_UE_MAX
+ * 3) Sets errno to EMSGSIZE if the code is longer than the entire bit queue buffer
+ * 4) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bq The destination bit queue
+ * @param value The value to write
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_ue(bit_queue_t *bq, uint32_t value);
+
+/**
+ * @brief This function writes a signed Exp-Golomb code se(v), the value k is coded as ue(2k - 1) if k > 0 and ue(-2k) otherwise
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL
+ * 2) Sets errno ERANGE if value = INT32_MIN
+ * 3) Sets errno to EMSGSIZE if the code is longer than the entire bit queue buffer
+ * 4) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bq The destination bit queue
+ * @param value The value to write
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_se(bit_queue_t *bq, int32_t value);
+
+/**
+ * @brief This function reads an unsigned Exp-Golomb code ue(v)
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or value = NULL
+ * 2) Sets errno EBADMSG if the code has more than 31 leading zeros
+ * 3) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bq The source bit queue
+ * @param value Returns the decoded value
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_ue(bit_queue_t *bq, uint32_t *value);
+
+/**
+ * @brief This function reads a signed Exp-Golomb code se(v)
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or value = NULL
+ * 2) Sets errno EBADMSG if the code has more than 31 leading zeros
+ * 3) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bq The source bit queue
+ * @param value Returns the decoded value
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_se(bit_queue_t *bq, int32_t *value);
+
+/**
+ * @brief The largest Golomb-Rice parameter
+ * @ingroup bit_queue_golomb
+ */
+#define BIT_QUEUE_RICE_MAX_K 31
+
+/**
+ * @brief The length of the zero prefix that escapes a Golomb-Rice code to the raw value
+ * @ingroup bit_queue_golomb
+ */
+#define BIT_QUEUE_RICE_ESCAPE 32
+
+/**
+ * @brief The number of values in a block of a Golomb-Rice coded array
+ * @ingroup bit_queue_golomb
+ */
+#define BIT_QUEUE_RICE_BLOCK 64
+
+/**
+ * @brief This function writes a Golomb-Rice code
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or k > BIT_QUEUE_RICE_MAX_K
+ * 2) Sets errno to EMSGSIZE if the code is longer than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bq The destination bit queue
+ * @param value The value to write
+ * @param k The Golomb-Rice parameter
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_rice(bit_queue_t *bq, uint32_t value, uint8_t k);
+
+/**
+ * @brief This function reads a Golomb-Rice code
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or value = NULL or k > BIT_QUEUE_RICE_MAX_K
+ * 2) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bq The source bit queue
+ * @param value Returns the decoded value
+ * @param k The Golomb-Rice parameter
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_rice(bit_queue_t *bq, uint32_t *value, uint8_t k);
+
+/**
+ * @brief This function writes an array of values as Golomb-Rice coded blocks with an adaptive parameter.
+ * Either all of the blocks are written or none of them.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or values = NULL or count = 0
+ * 2) Sets errno to EMSGSIZE if the coded array is larger than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 4) The errno is set by the allocation method (arrays of more than 4096 values)
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bq The destination bit queue
+ * @param values The values to write
+ * @param count The number of values
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_rice_u32(bit_queue_t *bq, const uint32_t *values, size_t count);
+
+/**
+ * @brief This function reads an array of values written by bit_queue_write_rice_u32.
+ * The codes are decoded from a local window that is refilled from the queue, either all of the blocks are read or
+ * none of them.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or values = NULL or count = 0
+ * 2) Sets errno to EMSGSIZE if the coded array is longer than the largest return value
+ * 3) Sets errno to EAGAIN if the queue doesn't hold the whole array
+ * 
+ * @ingroup bit_queue_golomb
+ * 
+ * @param bq The source bit queue
+ * @param values Returns the decoded values. The array is decoded as it is scanned so on EAGAIN the values up to the
+ * one the queue ran short of are overwritten and the rest are left as they were
+ * @param count The number of values, the count given to bit_queue_write_rice_u32
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_rice_u32(bit_queue_t *bq, uint32_t *values, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_GOLOMB_H_
@@ -0,0 +1,351 @@
+/**
+ * @file bit_queue_huffman.c
+ * @author amitfr1
+ * @brief Canonical Huffman codes over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @ingroup bit_queue_huffman
+ * 
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include "bit_queue_huffman.h"
+#include "bit_queue_internal.h"
+
+/**
+ * @brief The flag of a root table entry that points to a sub table
+ * @ingroup bit_queue_huffman
+ */
+#define ENTRY_SUB 0x80
+
+/**
+ * @brief The mask of the code length of a table entry (the number of index bits of a sub table pointer)
+ * @ingroup bit_queue_huffman
+ */
+#define ENTRY_LENGTH_MASK 0x1f
+
+/**
+ * @brief The shift of the symbol of a table entry (the offset of a sub table pointer)
+ * @ingroup bit_queue_huffman
+ */
+#define ENTRY_VALUE_SHIFT 8
+
+/**
+ * @brief This stuct holds the tables of a canonical Huffman code
+ * @ingroup bit_queue_huffman
+ */
+struct _bit_queue_huffman_t
+{
+    size_t symbol_count; /// The number of symbols
+    uint8_t max_length; /// The longest code length
+    uint8_t root_bits; /// The number of bits that index the root table
+    uint16_t * codes; /// The code of every symbol, bit reversed so the first bit of the code is the LSB
+    uint8_t * lengths; /// The code length of every symbol
+    uint32_t * table; /// The root decoding table followed by the sub tables
+};
+
+/**
+ * @brief This function reverses the bit order of a code
+ * 
+ * @ingroup bit_queue_huffman
+ * 
+ * @param code The code
+ * @param length The code length
+ * @return uint16_t The reversed code
+ */
+static uint16_t bit_queue_huffman_reverse(uint32_t code, uint8_t length);
+
+/**
+ * @brief This function fills the decoding tables from the codes
+ * 
+ * @ingroup bit_queue_huffman
+ * 
+ * @param huffman The code, the table is zeroed and large enough for the root and sub tables
+ * @param sub_bits The number of index bits of the sub table of every root entry (0 if it has no sub table)
+ */
+static void bit_queue_huffman_fill(bit_queue_huffman_t *huffman, const uint8_t *sub_bits);
+
+/**
+ * @brief This function looks up the table entry of the code in the low bits of a window
+ * 
+ * @ingroup bit_queue_huffman
+ * 
+ * @param huffman The code
+ * @param window The next bits of the queue
+ * @return uint32_t The entry, the code length is 0 if the bits don't match a code
+ */
+static inline uint32_t bit_queue_huffman_lookup(const bit_queue_huffman_t *huffman, uint64_t window);
+
+bit_queue_huffman_t * bit_queue_huffman_init(const uint8_t *lengths, size_t symbol_count)
+{
+    bit_queue_huffman_t * huffman = NULL;
+    uint8_t sub_bits[1 << BIT_QUEUE_HUFFMAN_ROOT_BITS] = {0};
+    size_t length_count[BIT_QUEUE_HUFFMAN_MAX_LENGTH + 1] = {0};
+    uint32_t next_code[BIT_QUEUE_HUFFMAN_MAX_LENGTH + 1];
+    uint8_t max_length = 0;
+    uint8_t root_bits;
+    uint16_t * codes;
+    size_t table_size;
+    size_t i;
+    uint32_t code = 0;
+    int64_t left = 1;
+    for (i = 0; lengths != NULL && i < symbol_count && i < BIT_QUEUE_HUFFMAN_MAX_SYMBOLS; i++)
+    {
+        length_count[lengths[i] <= BIT_QUEUE_HUFFMAN_MAX_LENGTH ? lengths[i] : 0]++;
+        max_length = lengths[i] > max_length ? lengths[i] : max_length;
+    }
+    // each length doubles the number of codes and the codes of that length use some of them
+    for (i = 1; i <= BIT_QUEUE_HUFFMAN_MAX_LENGTH && left >= 0; i++)
+    {
+        left = 2 * left - length_count[i];
+    }
+    root_bits = max_length < BIT_QUEUE_HUFFMAN_ROOT_BITS ? max_length : BIT_QUEUE_HUFFMAN_ROOT_BITS;
+    if (lengths == NULL || symbol_count == 0 || symbol_count > BIT_QUEUE_HUFFMAN_MAX_SYMBOLS ||
+        max_length == 0 || max_length > BIT_QUEUE_HUFFMAN_MAX_LENGTH || left < 0)
+    {
+        errno = EINVAL;
+    }
+    else if (!(codes = malloc(symbol_count * sizeof(*codes))))
+    {
+        // errno is set by malloc
+    }
+    else
+    {
+        // the canonical codes, the first code of a length follows the last code of the previous length
+        length_count[0] = 0;
+        for (i = 1; i <= BIT_QUEUE_HUFFMAN_MAX_LENGTH; i++)
+        {
+            code = (code + length_count[i - 1]) << 1;
+            next_code[i] = code;
+        }
+        for (i = 0; i < symbol_count; i++)
+        {
+            codes[i] = lengths[i] ? bit_queue_huffman_reverse(next_code[lengths[i]]++, lengths[i]) : 0;
+            // the sub table of a root entry is indexed by the bits past the root bits of its longest code
+            if (lengths[i] > root_bits && lengths[i] - root_bits > sub_bits[codes[i] & ((1 << root_bits) - 1)])
+            {
+                sub_bits[codes[i] & ((1 << root_bits) - 1)] = lengths[i] - root_bits;
+            }
+        }
+        table_size = 1 << root_bits;
+        for (i = 0; i < 1U << root_bits; i++)
+        {
+            table_size += sub_bits[i] ? 1 << sub_bits[i] : 0;
+        }
+        if (!(huffman = calloc(1, sizeof(*huffman) + symbol_count + table_size * sizeof(uint32_t))))
+        {
+            // errno is set by calloc
+            free(codes);
+        }
+        else
+        {
+            // the table is placed first so its entries are aligned
+            huffman->table = (uint32_t *)(huffman + 1);
+            huffman->lengths = (uint8_t *)(huffman->table + table_size);
+            memcpy(huffman->lengths, lengths, symbol_count);
+            huffman->codes = codes;
+            huffman->symbol_count = symbol_count;
+            huffman->max_length = max_length;
+            huffman->root_bits = root_bits;
+            bit_queue_huffman_fill(huffman, sub_bits);
+        }
+    }
+    return huffman;
+}
+
+int bit_queue_write_huffman(bit_queue_t *bq, const bit_queue_huffman_t *huffman, uint32_t symbol)
+{
+    int ret_val = -1;
+    if (bq == NULL || bq->buffer == NULL || huffman == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if (symbol >= huffman->symbol_count || !huffman->lengths[symbol])
+    {
+        errno = ERANGE;
+    }
+    else if (huffman->lengths[symbol] > bq->buffer_size * BITS_IN_BYTE)
+    {
+        // a code longer than the whole buffer would never fit
+        errno = EMSGSIZE;
+    }
+    else if (!bit_queue_has_space(bq, huffman->lengths[symbol]))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        bit_queue_put_bits(bq, huffman->codes[symbol], huffman->lengths[symbol]);
+        bit_queue_publish_write(bq, huffman->lengths[symbol]);
+        ret_val = huffman->lengths[symbol];
+    }
+    return ret_val;
+}
+
+int bit_queue_read_huffman(bit_queue_t *bq, const bit_queue_huffman_t *huffman, uint32_t *symbol)
+{
+    int ret_val = -1;
+    uint64_t window;
+    uint32_t entry;
+    size_t avail;
+    size_t length;
+    if (bq == NULL || bq->buffer == NULL || huffman == NULL || symbol == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if (!(avail = bit_queue_peek_bits(bq, 0, &window)))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        entry = bit_queue_huffman_lookup(huffman, window);
+        length = entry & ENTRY_LENGTH_MASK;
+        if (!length)
+        {
+            // the bits past avail are zero so a short window may look like a missing code
+            errno = avail < huffman->max_length ? EAGAIN : EBADMSG;
+        }
+        else if (length > avail)
+        {
+            errno = EAGAIN;
+        }
+        else
+        {
+            *symbol = entry >> ENTRY_VALUE_SHIFT;
+            bit_queue_advance_read(bq, length);
+            bit_queue_publish_read(bq, length);
+            ret_val = length;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_read_huffman_n(bit_queue_t *bq, const bit_queue_huffman_t *huffman, uint32_t *symbols, size_t count)
+{
+    int ret_val = -1;
+    uint64_t window = 0;
+    uint32_t entry;
+    size_t avail = 0;
+    size_t length;
+    size_t used = 0;
+    size_t decoded = 0;
+    if (bq == NULL || bq->buffer == NULL || huffman == NULL || symbols == NULL || count == 0)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        while (decoded < count && decoded <= INT32_MAX)
+        {
+            if (avail < huffman->max_length)
+            {
+                // refill the window at the first bit that isn't decoded yet
+                avail = bit_queue_peek_bits(bq, used, &window);
+            }
+            entry = bit_queue_huffman_lookup(huffman, window);
+            length = entry & ENTRY_LENGTH_MASK;
+            if (!length || length > avail)
+            {
+                errno = !length && avail >= huffman->max_length ? EBADMSG : EAGAIN;
+                break;
+            }
+            symbols[decoded++] = entry >> ENTRY_VALUE_SHIFT;
+            window >>= length;
+            avail -= length;
+            used += length;
+        }
+        if (decoded)
+        {
+            bit_queue_advance_read(bq, used);
+            bit_queue_publish_read(bq, used);
+            ret_val = decoded;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_huffman_destroy(bit_queue_huffman_t *huffman)
+{
+    int ret_val = -1;
+    if (huffman == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        free(huffman->codes);
+        free(huffman);
+        ret_val = 0;
+    }
+    return ret_val;
+}
+
+// static functions
+
+static uint16_t bit_queue_huffman_reverse(uint32_t code, uint8_t length)
+{
+    uint16_t reversed = 0;
+    uint8_t i;
+    for (i = 0; i < length; i++)
+    {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    return reversed;
+}
+
+static void bit_queue_huffman_fill(bit_queue_huffman_t *huffman, const uint8_t *sub_bits)
+{
+    uint32_t root_mask = (1U << huffman->root_bits) - 1;
+    uint32_t offset = root_mask + 1;
+    uint32_t entry;
+    uint32_t base;
+    size_t symbol;
+    size_t i;
+    // place the sub tables after the root table
+    for (i = 0; i <= root_mask; i++)
+    {
+        if (sub_bits[i])
+        {
+            huffman->table[i] = (offset << ENTRY_VALUE_SHIFT) | ENTRY_SUB | sub_bits[i];
+            offset += 1U << sub_bits[i];
+        }
+    }
+    for (symbol = 0; symbol < huffman->symbol_count; symbol++)
+    {
+        entry = (symbol << ENTRY_VALUE_SHIFT) | huffman->lengths[symbol];
+        if (!huffman->lengths[symbol])
+        {
+            continue;
+        }
+        else if (huffman->lengths[symbol] <= huffman->root_bits)
+        {
+            // every root index that starts with the code
+            for (i = huffman->codes[symbol]; i <= root_mask; i += 1U << huffman->lengths[symbol])
+            {
+                huffman->table[i] = entry;
+            }
+        }
+        else
+        {
+            base = huffman->table[huffman->codes[symbol] & root_mask];
+            for (i = huffman->codes[symbol] >> huffman->root_bits; i < 1U << (base & ENTRY_LENGTH_MASK);
+                 i += 1U << (huffman->lengths[symbol] - huffman->root_bits))
+            {
+                huffman->table[(base >> ENTRY_VALUE_SHIFT) + i] = entry;
+            }
+        }
+    }
+}
+
+static inline uint32_t bit_queue_huffman_lookup(const bit_queue_huffman_t *huffman, uint64_t window)
+{
+    uint32_t entry = huffman->table[window & ((1U << huffman->root_bits) - 1)];
+    if (entry & ENTRY_SUB)
+    {
+        entry = huffman->table[(entry >> ENTRY_VALUE_SHIFT) + ((window >> huffman->root_bits) & ((1U << (entry & ENTRY_LENGTH_MASK)) - 1))];
+    }
+    return entry;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file bit_queue_huffman.h
+ * @author amitfr1
+ * @brief Canonical Huffman codes over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_huffman
+ * This module writes and reads canonical Huffman codes directly on the bit queue buffer.
+ * A code is built from the code length of every symbol: the codes are assigned in increasing length order and
+ * in symbol order within a length, as in deflate. The first bit of a code is the first bit written to the queue.
+ * Decoding peeks a window of the queue and resolves a symbol with one lookup in a root table indexed by the next
+ * BIT_QUEUE_HUFFMAN_ROOT_BITS bits, longer codes take one more lookup in a sub table.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "bit_queue.h"
+
+#ifndef BIT_QUEUE_HUFFMAN_H_
+#define BIT_QUEUE_HUFFMAN_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The longest code length
+ * @ingroup bit_queue_huffman
+ */
+#define BIT_QUEUE_HUFFMAN_MAX_LENGTH 16
+
+/**
+ * @brief The largest number of symbols in a code
+ * @ingroup bit_queue_huffman
+ */
+#define BIT_QUEUE_HUFFMAN_MAX_SYMBOLS 65536
+
+/**
+ * @brief The number of bits that index the root decoding table
+ * @ingroup bit_queue_huffman
+ */
+#define BIT_QUEUE_HUFFMAN_ROOT_BITS 11
+
+typedef struct _bit_queue_huffman_t bit_queue_huffman_t;
+
+/**
+ * @brief This function creates the encoding and decoding tables of a canonical Huffman code
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if lengths = NULL or symbol_count = 0 or symbol_count > BIT_QUEUE_HUFFMAN_MAX_SYMBOLS or
+ *    a length is larger than BIT_QUEUE_HUFFMAN_MAX_LENGTH or no symbol has a code or the lengths are over subscribed
+ * 2) The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue_huffman
+ * 
+ * @param lengths The code length of every symbol, 0 for a symbol without a code
+ * @param symbol_count The number of symbols
+ * 
+ * @return bit_queue_huffman_t* Address of the created code or NULL in failure
+ */
+bit_queue_huffman_t * bit_queue_huffman_init(const uint8_t *lengths, size_t symbol_count);
+
+/**
+ * @brief This function writes the code of a symbol
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or huffman = NULL
+ * 2) Sets errno ERANGE if the symbol doesn't have a code
+ * 3) Sets errno to EMSGSIZE if the code is longer than the entire bit queue buffer
+ * 4) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_huffman
+ * 
+ * @param bq The destination bit queue
+ * @param huffman The code
+ * @param symbol The symbol to write
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_huffman(bit_queue_t *bq, const bit_queue_huffman_t *huffman, uint32_t symbol);
+
+/**
+ * @brief This function reads the code of a symbol
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or huffman = NULL or symbol = NULL
+ * 2) Sets errno EBADMSG if the bits don't match a code (the code is incomplete)
+ * 3) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_huffman
+ * 
+ * @param bq The source bit queue
+ * @param huffman The code
+ * @param symbol Returns the symbol read
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_huffman(bit_queue_t *bq, const bit_queue_huffman_t *huffman, uint32_t *symbol);
+
+/**
+ * @brief This function reads the codes of up to count symbols.
+ * The symbols are decoded from a local window that is refilled from the queue and the bits read are published once.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or huffman = NULL or symbols = NULL or count = 0
+ * 2) Sets errno EBADMSG if the first bits don't match a code
+ * 3) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_huffman
+ * 
+ * @param bq The source bit queue
+ * @param huffman The code
+ * @param symbols Returns the symbols read
+ * @param count The largest number of symbols to read
+ * 
+ * @return int The number of symbols read or -1 in failure
+ */
+int bit_queue_read_huffman_n(bit_queue_t *bq, const bit_queue_huffman_t *huffman, uint32_t *symbols, size_t count);
+
+/**
+ * @brief This function frees the code tables
+ * 
+ * Sets errno EINVAL if huffman = NULL
+ * 
+ * @ingroup bit_queue_huffman
+ * 
+ * @param huffman The code
+ * 
+ * @return int 0 in success or -1 in failure
+ */
+int bit_queue_huffman_destroy(bit_queue_huffman_t *huffman);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_HUFFMAN_H_
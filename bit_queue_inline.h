@@ -0,0 +1,370 @@
+/**
+ * @file bit_queue_inline.h
+ * @author amitfr1
+ * @brief Header only fast path for small reads and writes of the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_inline
+ * This header exposes the layout of the queue so reads and writes of 1 - 64 bits inline into the caller and a
+ * constant bit count folds into the shifts and masks. The fast path serves a transfer when the cached opposite
+ * counter already covers it and the cursor is at least a word away from the end of the buffer, it does one unaligned
+ * load (and store) and publishes the new count. A transfer of more than 57 bits at an unaligned cursor also merges
+ * the byte after the word. Everything else (wrapping, a stale cache, errors and transfers of more than 64 bits) goes
+ * through the out-of-line functions, so the results and errno are the same as theirs.
+ * When the library is built with BIT_QUEUE_STATS or BIT_QUEUE_LATENCY every call takes the out-of-line path so the
+ * counters and histograms stay exact. The layout depends on BIT_QUEUE_STATS, BIT_QUEUE_LATENCY and
+ * BIT_QUEUE_PACKED_LAYOUT, the CMake library targets export them so a caller linking them is compiled with the same
+ * definitions, any other caller must define them as the library was built.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include "bit_queue.h"
+#include "bit_queue_internal.h"
+
+#ifndef BIT_QUEUE_INLINE_H_
+#define BIT_QUEUE_INLINE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The largest bit count served by the fast path of bit_queue_read_value and bit_queue_write_value
+ * @ingroup bit_queue_inline
+ */
+#define BIT_QUEUE_INLINE_MAX_BITS 32
+
+/**
+ * @brief The largest bit count served by the fast path of bit_queue_read_value64 and bit_queue_write_value64
+ * @ingroup bit_queue_inline
+ */
+#define BIT_QUEUE_INLINE_MAX_BITS64 64
+
+/**
+ * @brief This define converts a little endian word to the host order and back, endian.h hides le64toh under strict
+ * feature test macros so the compiler byte order is used instead
+ * @ingroup bit_queue_inline
+ */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define BIT_QUEUE_INLINE_LE64(word) __builtin_bswap64(word)
+#else
+#define BIT_QUEUE_INLINE_LE64(word) (word)
+#endif
+
+/**
+ * @brief Whether the fast path is compiled in, the statistics and the latency histograms are only kept out of line
+ * @ingroup bit_queue_inline
+ */
+#if defined(BIT_QUEUE_STATS) || defined(BIT_QUEUE_LATENCY)
+#define BIT_QUEUE_INLINE_FAST_PATH 0
+#else
+#define BIT_QUEUE_INLINE_FAST_PATH 1
+#endif
+
+/**
+ * @brief This function reads up to 32 bits from the queue into the low bits of value, the first bit read is the LSB
+ *
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or value = NULL or bq->buffer = NULL or bit_count isn't 1 - 32
+ * 2) Sets errno to EAGAIN if there isn't enough data in the queue
+ *
+ * @ingroup bit_queue_inline
+ *
+ * @param bq The bit queue
+ * @param value Returns the bits read, the bits above bit_count are zeroed
+ * @param bit_count The amount of bits to read (1 - 32)
+ *
+ * @return int The number of bits read or -1 in failure
+ */
+static inline int bit_queue_read_value(bit_queue_t *bq, uint32_t *value, size_t bit_count)
+{
+    int ret_val;
+    uint8_t bytes[BIT_QUEUE_INLINE_MAX_BITS / BITS_IN_BYTE] = {0};
+    size_t read_count;
+    size_t bit_pos;
+    uint64_t word;
+    if (BIT_QUEUE_INLINE_FAST_PATH && bq != NULL && value != NULL && bit_count - 1 < BIT_QUEUE_INLINE_MAX_BITS && bq->buffer != NULL &&
+        bq->r_byte_offset + sizeof(word) < bq->buffer_size &&
+        bq->w_count_cache - (read_count = BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed)) >= bit_count)
+    {
+        // the word can't reach the end of the buffer so the read doesn't wrap
+        memcpy(&word, bq->buffer + bq->r_byte_offset, sizeof(word));
+        *value = (BIT_QUEUE_INLINE_LE64(word) >> bq->r_bit_offset) & ((1ULL << bit_count) - 1);
+        bit_pos = bq->r_bit_offset + bit_count;
+        bq->r_byte_offset += bit_pos / BITS_IN_BYTE;
+        bq->r_bit_offset = bit_pos % BITS_IN_BYTE;
+        // the store must be ordered before the load of the waiting target (pairs with bit_queue_wait)
+        read_count += bit_count;
+        BIT_QUEUE_STORE(&bq->shared->read_count, read_count, seq_cst);
+        BIT_QUEUE_PROBE(read, bq, bit_count, bq->w_count_cache - read_count);
+        if (BIT_QUEUE_LOAD(&bq->shared->w_wait_count, seq_cst) || bq->data_fd != -1)
+        {
+            bit_queue_notify_read(bq, read_count);
+        }
+        ret_val = bit_count;
+    }
+    else if (value == NULL)
+    {
+        ret_val = -1;
+        errno = EINVAL;
+    }
+    // errno is set by bit_queue_read_bits, a bit count above 32 doesn't fit the bytes and fails with EINVAL
+    else if ((ret_val = bit_queue_read_bits(bq, bytes, sizeof(bytes), bit_count)) != -1)
+    {
+        *value = (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    }
+    return ret_val;
+}
+
+/**
+ * @brief This function writes the low bits of value to the queue, the first bit written is the LSB
+ *
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or bit_count isn't 1 - 32
+ * 2) Sets errno to EAGAIN if there isn't enough space in the queue
+ *
+ * @ingroup bit_queue_inline
+ *
+ * @param bq The bit queue
+ * @param value The bits to write, the bits above bit_count are ignored
+ * @param bit_count The amount of bits to write (1 - 32)
+ *
+ * @return int The number of bits written or -1 in failure
+ */
+static inline int bit_queue_write_value(bit_queue_t *bq, uint32_t value, size_t bit_count)
+{
+    int ret_val;
+    uint8_t bytes[BIT_QUEUE_INLINE_MAX_BITS / BITS_IN_BYTE] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    size_t write_count;
+    size_t bit_pos;
+    uint64_t mask;
+    uint64_t word;
+    if (BIT_QUEUE_INLINE_FAST_PATH && bq != NULL && bit_count - 1 < BIT_QUEUE_INLINE_MAX_BITS && bq->buffer != NULL &&
+        bq->w_byte_offset + sizeof(word) < bq->buffer_size &&
+        bq->buffer_size * BITS_IN_BYTE - ((write_count = BIT_QUEUE_LOAD(&bq->shared->write_count, relaxed)) - bq->r_count_cache) >= bit_count)
+    {
+        // the word can't reach the end of the buffer so the write doesn't wrap
+        mask = ((1ULL << bit_count) - 1) << bq->w_bit_offset;
+        memcpy(&word, bq->buffer + bq->w_byte_offset, sizeof(word));
+        word = BIT_QUEUE_INLINE_LE64((BIT_QUEUE_INLINE_LE64(word) & ~mask) | (((uint64_t)value << bq->w_bit_offset) & mask));
+        memcpy(bq->buffer + bq->w_byte_offset, &word, sizeof(word));
+        bit_pos = bq->w_bit_offset + bit_count;
+        bq->w_byte_offset += bit_pos / BITS_IN_BYTE;
+        bq->w_bit_offset = bit_pos % BITS_IN_BYTE;
+        // the store must be ordered before the load of the waiting target (pairs with bit_queue_wait)
+        write_count += bit_count;
+        BIT_QUEUE_STORE(&bq->shared->write_count, write_count, seq_cst);
+        BIT_QUEUE_PROBE(write, bq, bit_count, write_count - bq->r_count_cache);
+        if (BIT_QUEUE_LOAD(&bq->shared->r_wait_count, seq_cst) || bq->space_fd != -1)
+        {
+            bit_queue_notify_write(bq, write_count);
+        }
+        ret_val = bit_count;
+    }
+    else
+    {
+        // errno is set by bit_queue_write_bits, a bit count above 32 doesn't fit the bytes and fails with EINVAL
+        ret_val = bit_queue_write_bits(bq, bytes, sizeof(bytes), bit_count);
+    }
+    return ret_val;
+}
+
+/**
+ * @brief This function reads up to 64 bits from the queue into value, the first bit read is the LSB
+ *
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or value = NULL or bq->buffer = NULL or bit_count isn't 1 - 64
+ * 2) Sets errno to EAGAIN if there isn't enough data in the queue
+ *
+ * @ingroup bit_queue_inline
+ *
+ * @param bq The bit queue
+ * @param value Returns the bits read, the bits above bit_count are zeroed
+ * @param bit_count The amount of bits to read (1 - 64)
+ *
+ * @return int The number of bits read or -1 in failure
+ */
+static inline int bit_queue_read_value64(bit_queue_t *bq, uint64_t *value, size_t bit_count)
+{
+    int ret_val;
+    uint8_t bytes[BIT_QUEUE_INLINE_MAX_BITS64 / BITS_IN_BYTE] = {0};
+    size_t read_count;
+    size_t bit_pos;
+    uint64_t word;
+    if (BIT_QUEUE_INLINE_FAST_PATH && bq != NULL && value != NULL && bit_count - 1 < BIT_QUEUE_INLINE_MAX_BITS64 && bq->buffer != NULL &&
+        bq->r_byte_offset + sizeof(word) < bq->buffer_size &&
+        bq->w_count_cache - (read_count = BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed)) >= bit_count)
+    {
+        // the word and the byte after it can't reach the end of the buffer so the read doesn't wrap
+        memcpy(&word, bq->buffer + bq->r_byte_offset, sizeof(word));
+        word = BIT_QUEUE_INLINE_LE64(word) >> bq->r_bit_offset;
+        if (bq->r_bit_offset + bit_count > BIT_QUEUE_INLINE_MAX_BITS64)
+        {
+            word |= (uint64_t)bq->buffer[bq->r_byte_offset + sizeof(word)] << (BIT_QUEUE_INLINE_MAX_BITS64 - bq->r_bit_offset);
+        }
+        *value = bit_count < BIT_QUEUE_INLINE_MAX_BITS64 ? word & ((1ULL << bit_count) - 1) : word;
+        bit_pos = bq->r_bit_offset + bit_count;
+        bq->r_byte_offset += bit_pos / BITS_IN_BYTE;
+        bq->r_bit_offset = bit_pos % BITS_IN_BYTE;
+        // the store must be ordered before the load of the waiting target (pairs with bit_queue_wait)
+        read_count += bit_count;
+        BIT_QUEUE_STORE(&bq->shared->read_count, read_count, seq_cst);
+        BIT_QUEUE_PROBE(read, bq, bit_count, bq->w_count_cache - read_count);
+        if (BIT_QUEUE_LOAD(&bq->shared->w_wait_count, seq_cst) || bq->data_fd != -1)
+        {
+            bit_queue_notify_read(bq, read_count);
+        }
+        ret_val = bit_count;
+    }
+    else if (value == NULL)
+    {
+        ret_val = -1;
+        errno = EINVAL;
+    }
+    // errno is set by bit_queue_read_bits, a bit count above 64 doesn't fit the bytes and fails with EINVAL
+    else if ((ret_val = bit_queue_read_bits(bq, bytes, sizeof(bytes), bit_count)) != -1)
+    {
+        memcpy(&word, bytes, sizeof(word));
+        *value = BIT_QUEUE_INLINE_LE64(word);
+    }
+    return ret_val;
+}
+
+/**
+ * @brief This function writes the low bits of value to the queue, the first bit written is the LSB
+ *
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or bit_count isn't 1 - 64
+ * 2) Sets errno to EAGAIN if there isn't enough space in the queue
+ *
+ * @ingroup bit_queue_inline
+ *
+ * @param bq The bit queue
+ * @param value The bits to write, the bits above bit_count are ignored
+ * @param bit_count The amount of bits to write (1 - 64)
+ *
+ * @return int The number of bits written or -1 in failure
+ */
+static inline int bit_queue_write_value64(bit_queue_t *bq, uint64_t value, size_t bit_count)
+{
+    int ret_val;
+    uint8_t bytes[BIT_QUEUE_INLINE_MAX_BITS64 / BITS_IN_BYTE];
+    size_t write_count;
+    size_t bit_pos;
+    uint64_t mask;
+    uint64_t word;
+    uint8_t * pos;
+    if (BIT_QUEUE_INLINE_FAST_PATH && bq != NULL && bit_count - 1 < BIT_QUEUE_INLINE_MAX_BITS64 && bq->buffer != NULL &&
+        bq->w_byte_offset + sizeof(word) < bq->buffer_size &&
+        bq->buffer_size * BITS_IN_BYTE - ((write_count = BIT_QUEUE_LOAD(&bq->shared->write_count, relaxed)) - bq->r_count_cache) >= bit_count)
+    {
+        // the word and the byte after it can't reach the end of the buffer so the write doesn't wrap
+        mask = bit_count < BIT_QUEUE_INLINE_MAX_BITS64 ? (1ULL << bit_count) - 1 : ~0ULL;
+        value &= mask;
+        pos = bq->buffer + bq->w_byte_offset;
+        memcpy(&word, pos, sizeof(word));
+        word = BIT_QUEUE_INLINE_LE64((BIT_QUEUE_INLINE_LE64(word) & ~(mask << bq->w_bit_offset)) | (value << bq->w_bit_offset));
+        memcpy(pos, &word, sizeof(word));
+        if (bq->w_bit_offset + bit_count > BIT_QUEUE_INLINE_MAX_BITS64)
+        {
+            pos[sizeof(word)] = (uint8_t)((pos[sizeof(word)] & ~(mask >> (BIT_QUEUE_INLINE_MAX_BITS64 - bq->w_bit_offset))) |
+                (value >> (BIT_QUEUE_INLINE_MAX_BITS64 - bq->w_bit_offset)));
+        }
+        bit_pos = bq->w_bit_offset + bit_count;
+        bq->w_byte_offset += bit_pos / BITS_IN_BYTE;
+        bq->w_bit_offset = bit_pos % BITS_IN_BYTE;
+        // the store must be ordered before the load of the waiting target (pairs with bit_queue_wait)
+        write_count += bit_count;
+        BIT_QUEUE_STORE(&bq->shared->write_count, write_count, seq_cst);
+        BIT_QUEUE_PROBE(write, bq, bit_count, write_count - bq->r_count_cache);
+        if (BIT_QUEUE_LOAD(&bq->shared->r_wait_count, seq_cst) || bq->space_fd != -1)
+        {
+            bit_queue_notify_write(bq, write_count);
+        }
+        ret_val = bit_count;
+    }
+    else
+    {
+        word = BIT_QUEUE_INLINE_LE64(value);
+        memcpy(bytes, &word, sizeof(bytes));
+        // errno is set by bit_queue_write_bits, a bit count above 64 doesn't fit the bytes and fails with EINVAL
+        ret_val = bit_queue_write_bits(bq, bytes, sizeof(bytes), bit_count);
+    }
+    return ret_val;
+}
+
+/**
+ * @brief This function is bit_queue_read_bits with the transfers of up to 64 bits inlined
+ *
+ * @ingroup bit_queue_inline
+ *
+ * @param bq The bit queue
+ * @param buffer The destination buffer, the bits past bit_count are left as they were
+ * @param buffer_size The size of the buffer
+ * @param bit_count The amount of bits to read
+ *
+ * @return int The number of bits read or -1 in failure
+ */
+static inline int bit_queue_read_bits_inline(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, size_t bit_count)
+{
+    int ret_val;
+    uint64_t value;
+    size_t i;
+    if (buffer == NULL || bit_count - 1 >= BIT_QUEUE_INLINE_MAX_BITS64 || buffer_size * BITS_IN_BYTE < bit_count)
+    {
+        // errno is set by bit_queue_read_bits
+        ret_val = bit_queue_read_bits(bq, buffer, buffer_size, bit_count);
+    }
+    else if ((ret_val = bit_queue_read_value64(bq, &value, bit_count)) != -1)
+    {
+        for (i = 0; i * BITS_IN_BYTE < bit_count; i++)
+        {
+            // the last byte keeps its bits above bit_count
+            buffer[i] = bit_count - i * BITS_IN_BYTE >= BITS_IN_BYTE ? (uint8_t)(value >> (i * BITS_IN_BYTE)) :
+                (buffer[i] & (uint8_t)(BYTE_MASK << (bit_count - i * BITS_IN_BYTE))) | (uint8_t)(value >> (i * BITS_IN_BYTE));
+        }
+    }
+    return ret_val;
+}
+
+/**
+ * @brief This function is bit_queue_write_bits with the transfers of up to 64 bits inlined
+ *
+ * @ingroup bit_queue_inline
+ *
+ * @param bq The bit queue
+ * @param buffer The source buffer
+ * @param buffer_size The size of the buffer
+ * @param bit_count The amount of bits to write
+ *
+ * @return int The number of bits written or -1 in failure
+ */
+static inline int bit_queue_write_bits_inline(bit_queue_t *bq, uint8_t *buffer, size_t buffer_size, size_t bit_count)
+{
+    int ret_val;
+    uint64_t value = 0;
+    size_t i;
+    if (buffer == NULL || bit_count - 1 >= BIT_QUEUE_INLINE_MAX_BITS64 || buffer_size * BITS_IN_BYTE < bit_count)
+    {
+        // errno is set by bit_queue_write_bits
+        ret_val = bit_queue_write_bits(bq, buffer, buffer_size, bit_count);
+    }
+    else
+    {
+        for (i = 0; i * BITS_IN_BYTE < bit_count; i++)
+        {
+            value |= (uint64_t)buffer[i] << (i * BITS_IN_BYTE);
+        }
+        // errno is set by bit_queue_write_value64
+        ret_val = bit_queue_write_value64(bq, value, bit_count);
+    }
+    return ret_val;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_INLINE_H_
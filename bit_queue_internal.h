@@ -0,0 +1,426 @@
+/**
+ * @file bit_queue_internal.h
+ * @author amitfr1
+ * @brief The internal layout and primitives of the bit queue shared by the codec modules
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @ingroup bit_queue
+ * 
+ * This header is not part of the public interface, the layout may change between versions.
+ */
+#include <stddef.h>
+#include <stdalign.h>
+#ifdef __cplusplus
+#include <atomic>
+#else
+#include <stdatomic.h>
+#endif
+#include "bit_queue.h"
+
+#ifndef BIT_QUEUE_INTERNAL_H_
+#define BIT_QUEUE_INTERNAL_H_
+
+/**
+ * @brief These defines declare and access the atomic members of the layout, with the C11 atomics in C and std::atomic
+ * in C++ (which has the layout of _Atomic for the lock free types used here) so the layout and the inline functions
+ * compile as both. The order is the name of a memory order without its memory_order_ prefix
+ * @ingroup bit_queue
+ */
+#ifdef __cplusplus
+#define BIT_QUEUE_ATOMIC(type) std::atomic<type>
+#define BIT_QUEUE_LOAD(object, order) std::atomic_load_explicit(object, std::memory_order_##order)
+#define BIT_QUEUE_STORE(object, value, order) std::atomic_store_explicit(object, value, std::memory_order_##order)
+#define BIT_QUEUE_FETCH_ADD(object, value, order) std::atomic_fetch_add_explicit(object, value, std::memory_order_##order)
+#define BIT_QUEUE_EXCHANGE(object, value, order) std::atomic_exchange_explicit(object, value, std::memory_order_##order)
+#else
+#define BIT_QUEUE_ATOMIC(type) _Atomic(type)
+#define BIT_QUEUE_LOAD(object, order) atomic_load_explicit(object, memory_order_##order)
+#define BIT_QUEUE_STORE(object, value, order) atomic_store_explicit(object, value, memory_order_##order)
+#define BIT_QUEUE_FETCH_ADD(object, value, order) atomic_fetch_add_explicit(object, value, memory_order_##order)
+#define BIT_QUEUE_EXCHANGE(object, value, order) atomic_exchange_explicit(object, value, memory_order_##order)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The number of bits in a byte
+ * @ingroup bit_queue
+ */
+#define BITS_IN_BYTE 8
+
+/**
+ * @brief This is the mask of a byte
+ * @ingroup bit_queue
+ */
+#define BYTE_MASK 0x000000ff
+
+/**
+ * @brief The number of bits in the window returned by bit_queue_peek_bits
+ * @ingroup bit_queue
+ */
+#define WINDOW_BITS 64
+
+/**
+ * @brief The size of a cache line, fields owned by diffrent threads are kept on diffrent lines
+ * @ingroup bit_queue
+ */
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @brief This define starts a new cache line in a struct.
+ * Define BIT_QUEUE_PACKED_LAYOUT to pack the fields together (used to measure false sharing)
+ * @ingroup bit_queue
+ */
+#ifndef BIT_QUEUE_PACKED_LAYOUT
+#define CACHE_ALIGNED alignas(CACHE_LINE_SIZE)
+#else
+#define CACHE_ALIGNED
+#endif
+
+/**
+ * @brief This define adds to a statistics counter of the queue, it compiles to nothing without BIT_QUEUE_STATS.
+ * Each counter is written only by the side that owns it so a relaxed load and store are enough.
+ * @ingroup bit_queue
+ */
+#ifdef BIT_QUEUE_STATS
+#define BIT_QUEUE_STAT_ADD(counter, value) \
+    BIT_QUEUE_STORE(&(counter), BIT_QUEUE_LOAD(&(counter), relaxed) + (value), relaxed)
+#else
+#define BIT_QUEUE_STAT_ADD(counter, value)
+#endif
+
+/**
+ * @brief This define fires a static tracepoint (USDT) of the bit_queue provider with the queue, a bit count and the
+ * fill level of the queue in bits. The tracepoints are built in when <sys/sdt.h> is available and
+ * BIT_QUEUE_NO_PROBES isn't defined, each one is a single nop until bpftrace or perf attaches to it.
+ * @ingroup bit_queue
+ */
+#if !defined(BIT_QUEUE_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define BIT_QUEUE_PROBE(name, bq, bit_count, fill) DTRACE_PROBE3(bit_queue, name, bq, bit_count, fill)
+#endif
+#endif
+#ifndef BIT_QUEUE_PROBE
+#define BIT_QUEUE_PROBE(name, bq, bit_count, fill)
+#endif
+
+/**
+ * @brief The fill level of the queue in bits as the writer last saw it, an upper bound of the real one
+ * @ingroup bit_queue
+ */
+#define BIT_QUEUE_WRITER_FILL(bq) (BIT_QUEUE_LOAD(&(bq)->shared->write_count, relaxed) - (bq)->r_count_cache)
+
+/**
+ * @brief The fill level of the queue in bits as the reader last saw it, a lower bound of the real one
+ * @ingroup bit_queue
+ */
+#define BIT_QUEUE_READER_FILL(bq) ((bq)->w_count_cache - BIT_QUEUE_LOAD(&(bq)->shared->read_count, relaxed))
+
+#ifdef BIT_QUEUE_LATENCY
+/**
+ * @brief The number of bits of a value kept below its leading one in a latency histogram bucket
+ * @ingroup bit_queue
+ */
+#define LATENCY_SUB_BITS 4
+
+/**
+ * @brief The number of buckets of a latency histogram, enough for any 64 bit value
+ * @ingroup bit_queue
+ */
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+/**
+ * @brief The number of write stamps waiting for the reader
+ * @ingroup bit_queue
+ */
+#define LATENCY_STAMPS 64
+
+/**
+ * @brief This stuct holds a log-linear histogram of durations in ticks, written by one side and read by any thread
+ * @ingroup bit_queue
+ */
+struct _bit_queue_histogram
+{
+    BIT_QUEUE_ATOMIC(uint64_t) buckets[LATENCY_BUCKETS]; /// The number of samples in each bucket
+};
+
+/**
+ * @brief This stuct holds the write count of a write and the time it was published
+ * @ingroup bit_queue
+ */
+struct _bit_queue_stamp
+{
+    size_t count; /// The write count after the write
+    uint64_t ticks; /// The time of the write
+};
+
+/**
+ * @brief This stuct holds the latency histograms of a queue handle and the ring of write stamps.
+ * The stamps ring is a single producer single consumer ring, the writer owns head and the reader owns tail.
+ * @ingroup bit_queue
+ */
+struct _bit_queue_latency
+{
+    uint64_t start_ticks; /// The ticks when the handle was created, used to convert ticks to nanoseconds
+    uint64_t start_ns; /// The CLOCK_MONOTONIC time when the handle was created
+    CACHE_ALIGNED struct _bit_queue_histogram read; /// The read durations, reader owned
+    struct _bit_queue_histogram residence; /// The residence times, reader owned
+    CACHE_ALIGNED BIT_QUEUE_ATOMIC(size_t) stamp_tail; /// The next stamp to collect, reader owned
+    CACHE_ALIGNED struct _bit_queue_histogram write; /// The write durations, writer owned
+    CACHE_ALIGNED BIT_QUEUE_ATOMIC(size_t) stamp_head; /// The next stamp to fill, writer owned
+    struct _bit_queue_stamp stamps[LATENCY_STAMPS]; /// The stamps ring
+};
+#endif
+
+/**
+ * @brief This stuct holds the counters that the reader and the writer publish to each other.
+ * The counters are placed on their own cache lines since each one is written by one side and read by the other.
+ * The struct is embedded in the bit queue or placed in a shared memory segment when the queue is shared between processes.
+ * The number of bits that hold data in the buffer is write_count - read_count.
+ * 
+ * @ingroup bit_queue
+ */
+struct _bit_queue_shared
+{
+    CACHE_ALIGNED BIT_QUEUE_ATOMIC(size_t) read_count; /// The total number of bits read, published to the writer
+    CACHE_ALIGNED BIT_QUEUE_ATOMIC(size_t) write_count; /// The total number of bits written, published to the reader
+
+    // sleeping state, only written when a side goes to sleep or wakes the other side
+    CACHE_ALIGNED BIT_QUEUE_ATOMIC(uint32_t) data_futex; /// Bumped by the writer to wake a sleeping reader
+    BIT_QUEUE_ATOMIC(uint32_t) space_futex; /// Bumped by the reader to wake a sleeping writer
+    BIT_QUEUE_ATOMIC(size_t) r_wait_count; /// The write_count a sleeping reader waits for or 0
+    BIT_QUEUE_ATOMIC(size_t) w_wait_count; /// The read_count a sleeping writer waits for or 0
+    BIT_QUEUE_ATOMIC(bool) data_raised; /// Whether data_fd is readable
+    BIT_QUEUE_ATOMIC(bool) space_raised; /// Whether space_fd is readable
+};
+
+/**
+ * @brief This stuct holds all the fields used in the bit queue
+ * The queue supports one reader thread and one writer thread running concurrently.
+ * The fields are split to a read only line, a reader owned line and a writer owned line so cursor updates don't bounce
+ * a shared cache line between the cores. Each side keeps a cached copy of the opposite counter and only reloads it
+ * when the cached value isn't enough to serve the request.
+ * 
+ * @ingroup bit_queue
+ */
+struct _bit_queue_t
+{
+    // read only after the initialization
+    uint8_t * buffer; /// The buffer that holds all of the data
+    size_t buffer_size; /// The buffer size in bytes
+    bool free_buff; /// An indication that the buffer should be freed with the bit queue
+    size_t map_size; /// The size of the buffer mapping or 0 if the buffer is not mapped
+    void * shm_base; /// The shared memory mapping that holds the buffer or NULL
+    struct _bit_queue_shared * shared; /// The published counters, points to local or into the shared memory segment
+    int futex_flags; /// FUTEX_PRIVATE_FLAG unless the counters are shared between processes
+    int data_fd; /// The eventfd readable while read_watermark bits hold data or -1
+    int space_fd; /// The eventfd readable while write_watermark bits are free or -1
+    size_t read_watermark; /// The data level that raises data_fd
+    size_t write_watermark; /// The free space level that raises space_fd
+#ifdef BIT_QUEUE_LATENCY
+    struct _bit_queue_latency * latency; /// The latency histograms of the handle
+#endif
+#ifdef BIT_QUEUE_STATS
+    size_t stat_read_base; /// The read_count when the handle was created
+    size_t stat_write_base; /// The write_count when the handle was created
+#endif
+
+    // reader owned
+    CACHE_ALIGNED uint8_t r_bit_offset; /// An index used to follow the bit progression in a byte while reading
+    size_t r_byte_offset; /// An index used to follow byte progression while reading
+    size_t w_count_cache; /// The last write_count seen by the reader
+    size_t r_spin_limit; /// The adaptive number of spins before the reader sleeps
+#ifdef BIT_QUEUE_STATS
+    BIT_QUEUE_ATOMIC(size_t) r_stat_calls; /// The number of reads
+    BIT_QUEUE_ATOMIC(size_t) r_stat_eagain; /// The number of reads that failed with EAGAIN
+#endif
+
+    // writer owned
+    CACHE_ALIGNED uint8_t w_bit_offset; /// An index used to follow the bit progression in a byte while writing
+    size_t w_byte_offset; /// An index used to follow byte progression while writing
+    size_t r_count_cache; /// The last read_count seen by the writer
+    size_t w_spin_limit; /// The adaptive number of spins before the writer sleeps
+#ifdef BIT_QUEUE_STATS
+    BIT_QUEUE_ATOMIC(size_t) w_stat_calls; /// The number of writes
+    BIT_QUEUE_ATOMIC(size_t) w_stat_eagain; /// The number of writes that failed with EAGAIN
+    BIT_QUEUE_ATOMIC(size_t) w_stat_high_water; /// The largest level seen by the writer
+#endif
+
+    struct _bit_queue_shared local; /// The counters of a queue that isn't shared between processes
+};
+
+/**
+ * @brief This function checks if there is enough space to write all of the bits
+ * 
+ * Sets errno to EINVAL if bq = NULL
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * @param bit_count The number of bits we want to write
+ * @return true if there is sufficient space in the queue false otherwise 
+ */
+bool bit_queue_has_space(bit_queue_t *bq, size_t bit_count);
+
+/**
+ * @brief This function checks if there is enough data to read
+ * 
+ * Sets errno to EINVAL if bq = NULL
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * @param bit_count The number of bits we want to read
+ * @return true if there is sufficient data in the queue false otherwise 
+ */
+bool bit_queue_has_data(bit_queue_t *bq, size_t bit_count);
+
+/**
+ * @brief This function advances the read cursor of the queue, wrapping it at the end of the buffer
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * @param bit_count The number of bits read, at most the size of the buffer
+ */
+void bit_queue_advance_read(bit_queue_t *bq, size_t bit_count);
+
+/**
+ * @brief This function advances the write cursor of the queue, wrapping it at the end of the buffer
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * @param bit_count The number of bits written, at most the size of the buffer
+ */
+void bit_queue_advance_write(bit_queue_t *bq, size_t bit_count);
+
+/**
+ * @brief This function publishes the bits read to the writer and wakes it if it sleeps on the freed space
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * @param bit_count The number of bits read
+ */
+void bit_queue_publish_read(bit_queue_t *bq, size_t bit_count);
+
+/**
+ * @brief This function publishes the bits written to the reader and wakes it if it sleeps on the new data
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * @param bit_count The number of bits written
+ */
+void bit_queue_publish_write(bit_queue_t *bq, size_t bit_count);
+
+/**
+ * @brief This function wakes a writer sleeping on the space freed up to read_count and updates the eventfds,
+ * it is the part of bit_queue_publish_read that runs after the read count is stored
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * @param read_count The published read count
+ */
+void bit_queue_notify_read(bit_queue_t *bq, size_t read_count);
+
+/**
+ * @brief This function wakes a reader sleeping on the data written up to write_count and updates the eventfds,
+ * it is the part of bit_queue_publish_write that runs after the write count is stored
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue
+ * @param write_count The published write count
+ */
+void bit_queue_notify_write(bit_queue_t *bq, size_t write_count);
+
+/**
+ * @brief This function returns the next bits of the queue without consuming them.
+ * The first bit to be read is the LSB of the window and the bits past the returned count are zeroed.
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue (the caller is the reader)
+ * @param skip The number of bits to skip after the read cursor (at most the number of bits in the queue)
+ * @param window Returns up to WINDOW_BITS bits starting skip bits after the read cursor
+ * @return size_t The number of valid bits in the window
+ */
+size_t bit_queue_peek_bits(bit_queue_t *bq, size_t skip, uint64_t *window);
+
+/**
+ * @brief This function writes up to WINDOW_BITS bits at the write cursor and advances it without publishing them.
+ * The first bit written is the LSB of the value.
+ * The caller must check that the queue has space and publish the written bits with bit_queue_publish_write.
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param bq The bit queue (the caller is the writer)
+ * @param value The bits to write
+ * @param bit_count The number of bits to write (1 - WINDOW_BITS)
+ */
+void bit_queue_put_bits(bit_queue_t *bq, uint64_t value, size_t bit_count);
+
+#ifdef BIT_QUEUE_LATENCY
+/**
+ * @brief This function allocates zeroed latency histograms and records the start time used to convert the ticks
+ * 
+ * The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue
+ * 
+ * @return struct _bit_queue_latency* The histograms or NULL in failure
+ */
+struct _bit_queue_latency * bit_queue_latency_create(void);
+
+/**
+ * @brief This function returns the current time in ticks, the time stamp counter on x86 and nanoseconds elsewhere
+ * 
+ * @ingroup bit_queue
+ * 
+ * @return uint64_t The current time in ticks
+ */
+uint64_t bit_queue_latency_ticks(void);
+
+/**
+ * @brief This function adds a sample to a histogram, only the owning side may call it
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param histogram The histogram
+ * @param ticks The sample
+ */
+void bit_queue_latency_record(struct _bit_queue_histogram *histogram, uint64_t ticks);
+
+/**
+ * @brief This function stamps the write count and the time of a write if the stamps ring has room (writer side)
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param latency The histograms of the queue
+ * @param write_count The write count after the write
+ */
+void bit_queue_latency_stamp(struct _bit_queue_latency *latency, size_t write_count);
+
+/**
+ * @brief This function records the residence time of every stamp the read count passed (reader side)
+ * 
+ * @ingroup bit_queue
+ * 
+ * @param latency The histograms of the queue
+ * @param read_count The read count after the read
+ */
+void bit_queue_latency_collect(struct _bit_queue_latency *latency, size_t read_count);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_INTERNAL_H_
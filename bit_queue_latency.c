@@ -0,0 +1,201 @@
+/**
+ * @file bit_queue_latency.c
+ * @author amitfr1
+ * @brief Latency histograms of the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @ingroup bit_queue_latency
+ *
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include "bit_queue_latency.h"
+#include "bit_queue_internal.h"
+#if defined(BIT_QUEUE_LATENCY) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+#ifdef BIT_QUEUE_LATENCY
+/**
+ * @brief The number of sub buckets in each power of two
+ * @ingroup bit_queue_latency
+ */
+#define SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+
+/**
+ * @brief This function returns the CLOCK_MONOTONIC time in nanoseconds
+ * @ingroup bit_queue_latency
+ */
+static uint64_t bit_queue_latency_now_ns(void);
+
+/**
+ * @brief This function returns the histogram bucket of a value
+ * @ingroup bit_queue_latency
+ */
+static size_t bit_queue_latency_bucket(uint64_t value);
+
+/**
+ * @brief This function returns the largest value that falls in a bucket
+ * @ingroup bit_queue_latency
+ */
+static uint64_t bit_queue_latency_bucket_max(size_t bucket);
+
+struct _bit_queue_latency * bit_queue_latency_create(void)
+{
+    struct _bit_queue_latency * latency;
+    if ((latency = aligned_alloc(CACHE_LINE_SIZE, (sizeof(struct _bit_queue_latency) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE)))
+    {
+        memset(latency, 0, sizeof(struct _bit_queue_latency));
+        latency->start_ticks = bit_queue_latency_ticks();
+        latency->start_ns = bit_queue_latency_now_ns();
+    }
+    return latency;
+}
+
+uint64_t bit_queue_latency_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return bit_queue_latency_now_ns();
+#endif
+}
+
+void bit_queue_latency_record(struct _bit_queue_histogram *histogram, uint64_t ticks)
+{
+    BIT_QUEUE_ATOMIC(uint64_t) * bucket = &histogram->buckets[bit_queue_latency_bucket(ticks)];
+    BIT_QUEUE_STORE(bucket, BIT_QUEUE_LOAD(bucket, relaxed) + 1, relaxed);
+}
+
+void bit_queue_latency_stamp(struct _bit_queue_latency *latency, size_t write_count)
+{
+    size_t head = BIT_QUEUE_LOAD(&latency->stamp_head, relaxed);
+    if (head - BIT_QUEUE_LOAD(&latency->stamp_tail, acquire) < LATENCY_STAMPS)
+    {
+        latency->stamps[head % LATENCY_STAMPS].count = write_count;
+        latency->stamps[head % LATENCY_STAMPS].ticks = bit_queue_latency_ticks();
+        BIT_QUEUE_STORE(&latency->stamp_head, head + 1, release);
+    }
+}
+
+void bit_queue_latency_collect(struct _bit_queue_latency *latency, size_t read_count)
+{
+    size_t tail = BIT_QUEUE_LOAD(&latency->stamp_tail, relaxed);
+    size_t head = BIT_QUEUE_LOAD(&latency->stamp_head, acquire);
+    uint64_t now;
+    if (tail != head && latency->stamps[tail % LATENCY_STAMPS].count <= read_count)
+    {
+        now = bit_queue_latency_ticks();
+        // the stamps are in write order so the passed ones are at the tail
+        for (; tail != head && latency->stamps[tail % LATENCY_STAMPS].count <= read_count; tail++)
+        {
+            bit_queue_latency_record(&latency->residence, now - latency->stamps[tail % LATENCY_STAMPS].ticks);
+        }
+        BIT_QUEUE_STORE(&latency->stamp_tail, tail, release);
+    }
+}
+#endif
+
+int bit_queue_get_latency(bit_queue_t *bq, int histogram, const double *percentiles, size_t count, uint64_t *values_ns, uint64_t *samples)
+{
+    int ret_val = -1;
+#ifdef BIT_QUEUE_LATENCY
+    uint64_t snapshot[LATENCY_BUCKETS];
+    struct _bit_queue_histogram * source;
+    uint64_t total = 0;
+    uint64_t rank, seen, ticks;
+    double ns_per_tick;
+    size_t i, bucket;
+#endif
+    bool valid = bq != NULL && bq->buffer != NULL && (count == 0 || (percentiles != NULL && values_ns != NULL));
+    size_t j;
+    for (j = 0; valid && j < count; j++)
+    {
+        valid = percentiles[j] >= 0 && percentiles[j] <= 100;
+    }
+    if (!valid || histogram < BIT_QUEUE_LATENCY_READ || histogram > BIT_QUEUE_LATENCY_RESIDENCE)
+    {
+        errno = EINVAL;
+    }
+    else if (histogram == BIT_QUEUE_LATENCY_RESIDENCE && bq->shm_base != NULL)
+    {
+        // the stamps are kept by the handle so the reader of a shared queue never sees the ones of the writer
+        errno = ENOTSUP;
+    }
+    else
+    {
+#ifdef BIT_QUEUE_LATENCY
+        source = histogram == BIT_QUEUE_LATENCY_READ ? &bq->latency->read : histogram == BIT_QUEUE_LATENCY_WRITE ? &bq->latency->write : &bq->latency->residence;
+        for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+        {
+            snapshot[bucket] = BIT_QUEUE_LOAD(&source->buckets[bucket], relaxed);
+            total += snapshot[bucket];
+        }
+        // the tick rate is measured over the life of the handle
+        ticks = bit_queue_latency_ticks() - bq->latency->start_ticks;
+        ns_per_tick = ticks ? (double)(bit_queue_latency_now_ns() - bq->latency->start_ns) / ticks : 1;
+        for (i = 0; i < count; i++)
+        {
+            // the value of the sample at the percentile rank, the first sample is rank 1
+            rank = percentiles[i] / 100 * total + 0.5;
+            rank = rank ? rank : 1;
+            bucket = 0;
+            seen = snapshot[0];
+            while (seen < rank && bucket + 1 < LATENCY_BUCKETS)
+            {
+                seen += snapshot[++bucket];
+            }
+            values_ns[i] = total ? bit_queue_latency_bucket_max(bucket) * ns_per_tick + 0.5 : 0;
+        }
+        if (samples != NULL)
+        {
+            *samples = total;
+        }
+        ret_val = 0;
+#else
+        (void)samples;
+        errno = ENOTSUP;
+#endif
+    }
+    return ret_val;
+}
+
+// static functions
+
+#ifdef BIT_QUEUE_LATENCY
+static uint64_t bit_queue_latency_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static size_t bit_queue_latency_bucket(uint64_t value)
+{
+    size_t ret_val = value;
+    int exponent;
+    if (value >= SUB_BUCKETS)
+    {
+        // the power of two picks the row and the bits below the leading one pick the sub bucket
+        exponent = 63 - __builtin_clzll(value);
+        ret_val = ((size_t)(exponent - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) + ((value >> (exponent - LATENCY_SUB_BITS)) & (SUB_BUCKETS - 1));
+    }
+    return ret_val;
+}
+
+static uint64_t bit_queue_latency_bucket_max(size_t bucket)
+{
+    uint64_t ret_val = bucket;
+    int shift;
+    if (bucket >= SUB_BUCKETS)
+    {
+        shift = (bucket >> LATENCY_SUB_BITS) - 1;
+        ret_val = ((uint64_t)(SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1))) << shift) + ((1ULL << shift) - 1);
+    }
+    return ret_val;
+}
+#endif
@@ -0,0 +1,72 @@
+/**
+ * @file bit_queue_latency.h
+ * @author amitfr1
+ * @brief Latency histograms of the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_latency
+ * When the library is built with BIT_QUEUE_LATENCY every queue handle keeps three log-linear (HDR style) histograms:
+ * the duration of the successful bit_queue_read_bits and bit_queue_write_bits calls and the residence time of the data,
+ * from the write that published it to the read that consumed its last bit.
+ * The durations are measured with the time stamp counter (rdtsc) on x86 and with CLOCK_MONOTONIC elsewhere.
+ * A bucket covers 1/16 of its power of two so a reported value is at most 6.25% above the measured one.
+ * The residence time is sampled: the writer stamps its write count and time into a small ring after each write while
+ * the ring has room and the reader records the stamps its reads pass. The stamps are kept by the handle, so the
+ * residence time isn't available for a queue shared between processes (bit_queue_shm_create and bit_queue_shm_attach).
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "bit_queue.h"
+
+#ifndef BIT_QUEUE_LATENCY_H_
+#define BIT_QUEUE_LATENCY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The histogram of the bit_queue_read_bits durations
+ * @ingroup bit_queue_latency
+ */
+#define BIT_QUEUE_LATENCY_READ 0
+
+/**
+ * @brief The histogram of the bit_queue_write_bits durations
+ * @ingroup bit_queue_latency
+ */
+#define BIT_QUEUE_LATENCY_WRITE 1
+
+/**
+ * @brief The histogram of the times from publishing bits to reading them
+ * @ingroup bit_queue_latency
+ */
+#define BIT_QUEUE_LATENCY_RESIDENCE 2
+
+/**
+ * @brief This function returns percentiles of a latency histogram of the queue, it can be called from any thread.
+ *
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or the histogram is unknown or percentiles = NULL or
+ *    values_ns = NULL when count > 0 or a percentile is outside [0, 100]
+ * 2) Sets errno to ENOTSUP if the library was built without BIT_QUEUE_LATENCY or if the histogram is
+ *    BIT_QUEUE_LATENCY_RESIDENCE and the handle is of a shared memory queue
+ *
+ * @ingroup bit_queue_latency
+ *
+ * @param bq The bit queue
+ * @param histogram BIT_QUEUE_LATENCY_READ, BIT_QUEUE_LATENCY_WRITE or BIT_QUEUE_LATENCY_RESIDENCE
+ * @param percentiles The percentiles to return (50, 99, 99.9 ...)
+ * @param count The number of percentiles
+ * @param values_ns Returns the value of each percentile in nanoseconds, 0 if the histogram is empty
+ * @param samples Returns the number of samples in the histogram, can be NULL
+ *
+ * @return int 0 in success or -1 in failure
+ */
+int bit_queue_get_latency(bit_queue_t *bq, int histogram, const double *percentiles, size_t count, uint64_t *values_ns, uint64_t *samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_LATENCY_H_
@@ -0,0 +1,608 @@
+/**
+ * @file bit_queue_lz.c
+ * @author amitfr1
+ * @brief LZ block compression of bit queue contents
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <endian.h>
+#include <unistd.h>
+#include "bit_queue_lz.h"
+#include "bit_queue_internal.h"
+
+/**
+ * @brief The shortest match
+ * @ingroup bit_queue_lz
+ */
+#define MIN_MATCH 4
+
+/**
+ * @brief The number of bytes at the end of a block that are always literals
+ * @ingroup bit_queue_lz
+ */
+#define LAST_LITERALS 5
+
+/**
+ * @brief No match starts in the last MATCH_LIMIT bytes of a block
+ * @ingroup bit_queue_lz
+ */
+#define MATCH_LIMIT 12
+
+/**
+ * @brief The number of bits of the match finder hash
+ * @ingroup bit_queue_lz
+ */
+#define HASH_BITS 12
+
+/**
+ * @brief The largest match offset
+ * @ingroup bit_queue_lz
+ */
+#define MAX_OFFSET UINT16_MAX
+
+/**
+ * @brief The nibble value that continues a length in the following bytes
+ * @ingroup bit_queue_lz
+ */
+#define RUN_MASK 15
+
+/**
+ * @brief The size of a frame header
+ * @ingroup bit_queue_lz
+ */
+#define FRAME_HEADER_SIZE 8
+
+/**
+ * @brief The flag of the stored size of a block stored uncompressed
+ * @ingroup bit_queue_lz
+ */
+#define STORED_RAW 0x80000000U
+
+/**
+ * @brief This define hashes 4 bytes into the match finder table
+ * @ingroup bit_queue_lz
+ */
+#define HASH(seq) (((seq) * 2654435761U) >> (32 - HASH_BITS))
+
+/**
+ * @brief This stuct holds the file descriptor drained to and the frame buffer a block is compressed into
+ * @ingroup bit_queue_lz
+ */
+struct _bit_queue_lz_sink_t
+{
+    int fd; /// The destination file descriptor
+    uint8_t frame[FRAME_HEADER_SIZE + BIT_QUEUE_LZ_BOUND(BIT_QUEUE_LZ_BLOCK)]; /// The frame header and stored block
+};
+
+/**
+ * @brief This stuct holds the file descriptor filled from, the frame header kept between calls and the block buffers
+ * @ingroup bit_queue_lz
+ */
+struct _bit_queue_lz_source_t
+{
+    int fd; /// The source file descriptor
+    bool pending; /// Whether header holds a frame whose block wasn't read yet
+    uint32_t header[2]; /// The frame header, kept while its block doesn't fit the queue
+    uint8_t stored[BIT_QUEUE_LZ_BOUND(BIT_QUEUE_LZ_BLOCK)]; /// The stored block read from the file descriptor
+    uint8_t block[BIT_QUEUE_LZ_BLOCK]; /// The decompressed block when it can't be decompressed in place
+};
+
+/**
+ * @brief This function loads 4 bytes
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param src The bytes
+ * @return uint32_t The bytes in host order
+ */
+static inline uint32_t bit_queue_lz_load32(const uint8_t *src);
+
+/**
+ * @brief This function measures the match between two positions of a block
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param src The block
+ * @param end The position the match must end before
+ * @param ref The earlier position, its first MIN_MATCH bytes match
+ * @param ip The current position
+ * @return size_t The length of the match
+ */
+static size_t bit_queue_lz_match_length(const uint8_t *src, size_t end, size_t ref, size_t ip);
+
+/**
+ * @brief This function writes a block at the write cursor and advances it without publishing it
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param bq The destination bit queue
+ * @param block The block, it is already in place if it starts at the write cursor
+ * @param size The size of the block
+ */
+static void bit_queue_lz_put_block(bit_queue_t *bq, const uint8_t *block, size_t size);
+
+/**
+ * @brief This function writes the continuation bytes of a length
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param dst The destination
+ * @param length The length past RUN_MASK
+ * @return size_t The number of bytes written
+ */
+static size_t bit_queue_lz_put_length(uint8_t *dst, size_t length);
+
+/**
+ * @brief This function reads the continuation bytes of a length
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param src The compressed block
+ * @param src_size The size of the compressed block
+ * @param pos The position of the first continuation byte, advanced past the length
+ * @param length The length to add the continuation to
+ * @return true if the length is whole false otherwise
+ */
+static bool bit_queue_lz_get_length(const uint8_t *src, size_t src_size, size_t *pos, size_t *length);
+
+/**
+ * @brief This function writes a whole buffer to a file descriptor, retrying short and interrupted writes
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param fd The file descriptor
+ * @param buffer The buffer
+ * @param size The size of the buffer
+ * @return int 0 in success or -1 in failure (errno is set by write)
+ */
+static int bit_queue_lz_write_all(int fd, const uint8_t *buffer, size_t size);
+
+/**
+ * @brief This function reads a whole buffer from a file descriptor, retrying short and interrupted reads
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param fd The file descriptor
+ * @param buffer The buffer
+ * @param size The size of the buffer
+ * @return ssize_t The number of bytes read (less than size at the end of the file) or -1 in failure
+ */
+static ssize_t bit_queue_lz_read_all(int fd, uint8_t *buffer, size_t size);
+
+int bit_queue_lz_compress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size)
+{
+    int ret_val = -1;
+    uint32_t table[1 << HASH_BITS] = {0};
+    uint32_t seq;
+    size_t ip = 0;
+    size_t op = 0;
+    size_t anchor = 0;
+    size_t ref;
+    size_t length;
+    size_t literals;
+    bool fits = true;
+    if (src == NULL || dst == NULL || src_size > BIT_QUEUE_LZ_BLOCK)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        while (fits && ip + MATCH_LIMIT <= src_size)
+        {
+            // the table holds the last position + 1 of every hash, 0 is empty
+            seq = bit_queue_lz_load32(src + ip);
+            ref = table[HASH(seq)];
+            table[HASH(seq)] = ip + 1;
+            if (!ref-- || ip - ref > MAX_OFFSET || bit_queue_lz_load32(src + ref) != seq)
+            {
+                // skip faster through data that doesn't compress
+                ip += 1 + ((ip - anchor) >> 6);
+            }
+            else
+            {
+                length = bit_queue_lz_match_length(src, src_size - LAST_LITERALS, ref, ip);
+                literals = ip - anchor;
+                if ((fits = op + 1 + literals + literals / 255 + 1 + 2 + (length - MIN_MATCH) / 255 + 1 <= dst_size))
+                {
+                    dst[op++] = (literals < RUN_MASK ? literals : RUN_MASK) << 4 |
+                                (length - MIN_MATCH < RUN_MASK ? length - MIN_MATCH : RUN_MASK);
+                    op += literals >= RUN_MASK ? bit_queue_lz_put_length(dst + op, literals - RUN_MASK) : 0;
+                    memcpy(dst + op, src + anchor, literals);
+                    op += literals;
+                    dst[op++] = (ip - ref) & BYTE_MASK;
+                    dst[op++] = (ip - ref) >> BITS_IN_BYTE;
+                    op += length - MIN_MATCH >= RUN_MASK ? bit_queue_lz_put_length(dst + op, length - MIN_MATCH - RUN_MASK) : 0;
+                    ip += length;
+                    anchor = ip;
+                }
+            }
+        }
+        literals = src_size - anchor;
+        if (!fits || op + 1 + literals + literals / 255 + 1 > dst_size)
+        {
+            errno = EMSGSIZE;
+        }
+        else
+        {
+            // the last sequence holds only the remaining literals
+            dst[op++] = (literals < RUN_MASK ? literals : RUN_MASK) << 4;
+            op += literals >= RUN_MASK ? bit_queue_lz_put_length(dst + op, literals - RUN_MASK) : 0;
+            memcpy(dst + op, src + anchor, literals);
+            ret_val = op + literals;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_lz_decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size)
+{
+    int ret_val = -1;
+    size_t ip = 0;
+    size_t op = 0;
+    size_t literals;
+    size_t length;
+    size_t offset;
+    size_t i;
+    uint8_t token;
+    if (src == NULL || dst == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        // an empty block or a block that ends with a match is corrupted
+        errno = EBADMSG;
+        while (ip < src_size)
+        {
+            token = src[ip++];
+            literals = token >> 4;
+            if ((literals == RUN_MASK && !bit_queue_lz_get_length(src, src_size, &ip, &literals)) || literals > src_size - ip)
+            {
+                errno = EBADMSG;
+                break;
+            }
+            else if (literals > dst_size - op)
+            {
+                errno = EMSGSIZE;
+                break;
+            }
+            memcpy(dst + op, src + ip, literals);
+            ip += literals;
+            op += literals;
+            if (ip == src_size)
+            {
+                // the last sequence
+                ret_val = op;
+                break;
+            }
+            length = token & RUN_MASK;
+            if (src_size - ip < 2 || !(offset = src[ip] | (size_t)src[ip + 1] << BITS_IN_BYTE) || offset > op ||
+                (ip += 2, length == RUN_MASK && !bit_queue_lz_get_length(src, src_size, &ip, &length)))
+            {
+                errno = EBADMSG;
+                break;
+            }
+            else if ((length += MIN_MATCH) > dst_size - op)
+            {
+                errno = EMSGSIZE;
+                break;
+            }
+            else if (offset >= length)
+            {
+                memcpy(dst + op, dst + op - offset, length);
+            }
+            else
+            {
+                // the match overlaps the bytes it produces (a run)
+                for (i = 0; i < length; i++)
+                {
+                    dst[op + i] = dst[op + i - offset];
+                }
+            }
+            op += length;
+        }
+    }
+    return ret_val;
+}
+
+bit_queue_lz_sink_t * bit_queue_lz_sink_init(int fd)
+{
+    bit_queue_lz_sink_t * sink = NULL;
+    if (fd < 0)
+    {
+        errno = EINVAL;
+    }
+    else if ((sink = malloc(sizeof(bit_queue_lz_sink_t))))
+    {
+        sink->fd = fd;
+    }
+    // else errno is set by malloc
+    return sink;
+}
+
+ssize_t bit_queue_lz_drain(bit_queue_t *bq, bit_queue_lz_sink_t *sink)
+{
+    ssize_t ret_val = -1;
+    uint32_t header[2];
+    size_t size;
+    size_t stored;
+    int compressed;
+    if (bq == NULL || bq->buffer == NULL || sink == NULL || bq->r_bit_offset)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        ret_val = 0;
+        while (bit_queue_has_data(bq, BITS_IN_BYTE))
+        {
+            // the whole bytes of data up to the end of the buffer, compressed in place
+            size = (bq->w_count_cache - BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed)) / BITS_IN_BYTE;
+            size = size < bq->buffer_size - bq->r_byte_offset ? size : bq->buffer_size - bq->r_byte_offset;
+            size = size < BIT_QUEUE_LZ_BLOCK ? size : BIT_QUEUE_LZ_BLOCK;
+            compressed = bit_queue_lz_compress(bq->buffer + bq->r_byte_offset, size, sink->frame + FRAME_HEADER_SIZE, size);
+            if (compressed == -1)
+            {
+                // the block doesn't compress, store it
+                memcpy(sink->frame + FRAME_HEADER_SIZE, bq->buffer + bq->r_byte_offset, size);
+            }
+            stored = compressed == -1 ? size : (size_t)compressed;
+            header[0] = htole32(size);
+            header[1] = htole32(compressed == -1 ? stored | STORED_RAW : stored);
+            memcpy(sink->frame, header, sizeof(header));
+            if (bit_queue_lz_write_all(sink->fd, sink->frame, FRAME_HEADER_SIZE + stored) == -1)
+            {
+                // errno is set by write
+                ret_val = -1;
+                break;
+            }
+            bit_queue_advance_read(bq, size * BITS_IN_BYTE);
+            bit_queue_publish_read(bq, size * BITS_IN_BYTE);
+            ret_val += size;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_lz_sink_destroy(bit_queue_lz_sink_t *sink)
+{
+    int ret_val = -1;
+    if (sink == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        free(sink);
+        ret_val = 0;
+    }
+    return ret_val;
+}
+
+bit_queue_lz_source_t * bit_queue_lz_source_init(int fd)
+{
+    bit_queue_lz_source_t * source = NULL;
+    if (fd < 0)
+    {
+        errno = EINVAL;
+    }
+    else if ((source = malloc(sizeof(bit_queue_lz_source_t))))
+    {
+        source->fd = fd;
+        source->pending = false;
+    }
+    // else errno is set by malloc
+    return source;
+}
+
+ssize_t bit_queue_lz_fill(bit_queue_t *bq, bit_queue_lz_source_t *source)
+{
+    ssize_t ret_val = -1;
+    uint8_t * block;
+    size_t size = 0;
+    size_t stored_size = 0;
+    ssize_t n = 0;
+    if (bq == NULL || bq->buffer == NULL || source == NULL)
+    {
+        errno = EINVAL;
+    }
+    // the header of a frame whose block didn't fit the queue in an earlier call was already read
+    else if (!source->pending && (n = bit_queue_lz_read_all(source->fd, (uint8_t *)source->header, sizeof(source->header))) <= 0)
+    {
+        // the end of the stream or errno is set by read
+        ret_val = n;
+    }
+    else if ((!source->pending && n < (ssize_t)sizeof(source->header)) || (size = le32toh(source->header[0])) > BIT_QUEUE_LZ_BLOCK ||
+             (stored_size = le32toh(source->header[1]) & ~STORED_RAW) > BIT_QUEUE_LZ_BOUND(BIT_QUEUE_LZ_BLOCK) ||
+             ((le32toh(source->header[1]) & STORED_RAW) && stored_size != size))
+    {
+        errno = EBADMSG;
+    }
+    else if (size > bq->buffer_size)
+    {
+        // the block never fits the queue, the header is kept so the frame isn't lost
+        source->pending = true;
+        errno = EMSGSIZE;
+    }
+    else if (!bit_queue_has_space(bq, size * BITS_IN_BYTE))
+    {
+        // the header is kept until the queue has space for its block
+        source->pending = true;
+        errno = EAGAIN;
+    }
+    else
+    {
+        // the frame is consumed from fd from here on
+        source->pending = false;
+        if ((n = bit_queue_lz_read_all(source->fd, source->stored, stored_size)) == -1)
+        {
+            // errno is set by read
+        }
+        else if ((size_t)n < stored_size)
+        {
+            errno = EBADMSG;
+        }
+        else
+        {
+            // decompress in place when the block doesn't need shifting or wrapping
+            block = !bq->w_bit_offset && bq->w_byte_offset + size <= bq->buffer_size ? bq->buffer + bq->w_byte_offset : source->block;
+            if (le32toh(source->header[1]) & STORED_RAW)
+            {
+                memcpy(block, source->stored, size);
+            }
+            else if (bit_queue_lz_decompress(source->stored, stored_size, block, size) != (int)size)
+            {
+                errno = EBADMSG;
+                block = NULL;
+            }
+            if (block != NULL)
+            {
+                bit_queue_lz_put_block(bq, block, size);
+                bit_queue_publish_write(bq, size * BITS_IN_BYTE);
+                ret_val = size;
+            }
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_lz_source_destroy(bit_queue_lz_source_t *source)
+{
+    int ret_val = -1;
+    if (source == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        free(source);
+        ret_val = 0;
+    }
+    return ret_val;
+}
+
+// static functions
+
+static inline uint32_t bit_queue_lz_load32(const uint8_t *src)
+{
+    uint32_t value;
+    memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+static size_t bit_queue_lz_match_length(const uint8_t *src, size_t end, size_t ref, size_t ip)
+{
+    uint64_t diff = 0;
+    uint64_t a;
+    uint64_t b;
+    size_t length;
+    // compare 8 bytes at a time, the first differing byte is the lowest set byte of the xor
+    for (length = MIN_MATCH; !diff && ip + length + sizeof(diff) <= end; length += diff ? 0 : sizeof(diff))
+    {
+        memcpy(&a, src + ref + length, sizeof(a));
+        memcpy(&b, src + ip + length, sizeof(b));
+        if ((diff = le64toh(a) ^ le64toh(b)))
+        {
+            length += __builtin_ctzll(diff) / BITS_IN_BYTE;
+        }
+    }
+    while (!diff && ip + length < end && src[ref + length] == src[ip + length])
+    {
+        length++;
+    }
+    return length;
+}
+
+static void bit_queue_lz_put_block(bit_queue_t *bq, const uint8_t *block, size_t size)
+{
+    uint64_t word;
+    size_t n;
+    size_t i;
+    if (block == bq->buffer + bq->w_byte_offset)
+    {
+        bit_queue_advance_write(bq, size * BITS_IN_BYTE);
+    }
+    else
+    {
+        for (i = 0; i < size; i += n)
+        {
+            n = size - i < sizeof(word) ? size - i : sizeof(word);
+            word = 0;
+            memcpy(&word, block + i, n);
+            bit_queue_put_bits(bq, le64toh(word), n * BITS_IN_BYTE);
+        }
+    }
+}
+
+static size_t bit_queue_lz_put_length(uint8_t *dst, size_t length)
+{
+    size_t i = 0;
+    for (; length >= 255; length -= 255)
+    {
+        dst[i++] = 255;
+    }
+    dst[i++] = length;
+    return i;
+}
+
+static bool bit_queue_lz_get_length(const uint8_t *src, size_t src_size, size_t *pos, size_t *length)
+{
+    uint8_t byte = 255;
+    while (byte == 255 && *pos < src_size)
+    {
+        byte = src[(*pos)++];
+        *length += byte;
+    }
+    return byte != 255;
+}
+
+static int bit_queue_lz_write_all(int fd, const uint8_t *buffer, size_t size)
+{
+    int ret_val = 0;
+    ssize_t n;
+    while (size > 0)
+    {
+        if ((n = write(fd, buffer, size)) == -1 && errno != EINTR)
+        {
+            // errno is set by write
+            ret_val = -1;
+            break;
+        }
+        else if (n > 0)
+        {
+            buffer += n;
+            size -= n;
+        }
+    }
+    return ret_val;
+}
+
+static ssize_t bit_queue_lz_read_all(int fd, uint8_t *buffer, size_t size)
+{
+    ssize_t ret_val = 0;
+    ssize_t n;
+    while ((size_t)ret_val < size)
+    {
+        if ((n = read(fd, buffer + ret_val, size - ret_val)) == -1 && errno != EINTR)
+        {
+            // errno is set by read
+            ret_val = -1;
+            break;
+        }
+        else if (n == 0)
+        {
+            break;
+        }
+        else if (n > 0)
+        {
+            ret_val += n;
+        }
+    }
+    return ret_val;
+}
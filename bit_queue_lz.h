@@ -0,0 +1,184 @@
+/**
+ * @file bit_queue_lz.h
+ * @author amitfr1
+ * @brief LZ block compression of bit queue contents
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_lz
+ * This module compresses the committed bytes of a bit queue when they are drained to a file descriptor and
+ * decompresses them back into a queue when it is refilled from one.
+ * The codec is a self contained byte oriented LZ77 coder in the spirit of LZ4: a block is a list of sequences, each
+ * one made of a token byte (literal length in the high nibble, match length - 4 in the low nibble, 15 continues the
+ * length in bytes of 255), the literals, a 2 byte little endian match offset and the extra match length bytes.
+ * The last sequence of a block holds only literals.
+ * The drained stream is a list of frames: the raw size (4 bytes), the stored size (4 bytes, the MSB set if the block
+ * is stored uncompressed) and the stored block. All of the sizes are little endian.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "bit_queue.h"
+
+#ifndef BIT_QUEUE_LZ_H_
+#define BIT_QUEUE_LZ_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The largest number of bytes in a block
+ * @ingroup bit_queue_lz
+ */
+#define BIT_QUEUE_LZ_BLOCK (64 * 1024)
+
+/**
+ * @brief The largest size of a compressed block of size bytes
+ * @ingroup bit_queue_lz
+ */
+#define BIT_QUEUE_LZ_BOUND(size) ((size) + (size) / 255 + 16)
+
+/**
+ * @brief This function compresses a block
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if src = NULL or dst = NULL or src_size > BIT_QUEUE_LZ_BLOCK
+ * 2) Sets errno to EMSGSIZE if the compressed block doesn't fit dst_size bytes
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param src The block
+ * @param src_size The size of the block
+ * @param dst Returns the compressed block
+ * @param dst_size The size of dst, BIT_QUEUE_LZ_BOUND(src_size) is always enough
+ * 
+ * @return int The size of the compressed block or -1 in failure
+ */
+int bit_queue_lz_compress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+
+/**
+ * @brief This function decompresses a block
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if src = NULL or dst = NULL
+ * 2) Sets errno EBADMSG if the block is corrupted (truncated or a match before the start of the block)
+ * 3) Sets errno to EMSGSIZE if the decompressed block doesn't fit dst_size bytes
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param src The compressed block
+ * @param src_size The size of the compressed block
+ * @param dst Returns the block
+ * @param dst_size The size of dst
+ * 
+ * @return int The size of the block or -1 in failure
+ */
+int bit_queue_lz_decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+
+typedef struct _bit_queue_lz_sink_t bit_queue_lz_sink_t;
+
+typedef struct _bit_queue_lz_source_t bit_queue_lz_source_t;
+
+/**
+ * @brief This function creates a sink that drains queues to a file descriptor.
+ * The sink holds the frame buffer a block is compressed into, so draining doesn't allocate.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if fd < 0
+ * 2) The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param fd The destination file descriptor, it stays owned by the caller
+ * 
+ * @return bit_queue_lz_sink_t* Address of the created sink or NULL in failure
+ */
+bit_queue_lz_sink_t * bit_queue_lz_sink_init(int fd);
+
+/**
+ * @brief This function drains the whole bytes of data in the queue to the sink file descriptor as compressed frames.
+ * The bytes are compressed in place in the ring, a block ends at BIT_QUEUE_LZ_BLOCK bytes or at the end of the buffer.
+ * A block is consumed from the queue once its frame is written. The file descriptor is expected to be blocking.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or sink = NULL or the read cursor isn't byte aligned
+ * 2) The errno is set by write
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param bq The source bit queue (the caller is the reader)
+ * @param sink The destination sink
+ * 
+ * @return ssize_t The number of bytes drained from the queue or -1 in failure
+ */
+ssize_t bit_queue_lz_drain(bit_queue_t *bq, bit_queue_lz_sink_t *sink);
+
+/**
+ * @brief This function frees the sink, the file descriptor isn't closed
+ * 
+ * Sets errno EINVAL if sink = NULL
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param sink The sink
+ * 
+ * @return int 0 in success or -1 in failure
+ */
+int bit_queue_lz_sink_destroy(bit_queue_lz_sink_t *sink);
+
+/**
+ * @brief This function creates a source that fills queues from a file descriptor.
+ * The source holds the block buffers and the header of a frame read ahead, so filling doesn't allocate.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if fd < 0
+ * 2) The errno is set by the allocation method
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param fd The source file descriptor, it stays owned by the caller
+ * 
+ * @return bit_queue_lz_source_t* Address of the created source or NULL in failure
+ */
+bit_queue_lz_source_t * bit_queue_lz_source_init(int fd);
+
+/**
+ * @brief This function reads one frame from the source file descriptor and writes its decompressed block into the queue.
+ * The block is decompressed in place in the ring when the write cursor is byte aligned and the block doesn't wrap.
+ * The frame header is read first, when the queue doesn't have space for the block the header is kept in the source
+ * and the next call continues with it. The file descriptor is expected to be blocking.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or source = NULL
+ * 2) Sets errno to EMSGSIZE if the block is larger than the entire bit queue buffer (the header is kept)
+ * 3) Sets errno to EAGAIN if the queue doesn't have space for the block (the header is kept)
+ * 4) Sets errno EBADMSG if the frame is truncated or corrupted
+ * 5) The errno is set by read
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param bq The destination bit queue (the caller is the writer)
+ * @param source The source
+ * 
+ * @return ssize_t The number of bytes written to the queue, 0 at the end of the stream or -1 in failure
+ */
+ssize_t bit_queue_lz_fill(bit_queue_t *bq, bit_queue_lz_source_t *source);
+
+/**
+ * @brief This function frees the source, the file descriptor isn't closed
+ * 
+ * Sets errno EINVAL if source = NULL
+ * 
+ * @ingroup bit_queue_lz
+ * 
+ * @param source The source
+ * 
+ * @return int 0 in success or -1 in failure
+ */
+int bit_queue_lz_source_destroy(bit_queue_lz_source_t *source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_LZ_H_
@@ -0,0 +1,704 @@
+/**
+ * @file bit_queue_pack.c
+ * @author amitfr1
+ * @brief Fixed width bit packing of integer arrays over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ */
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <endian.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#if defined(__AVX2__) && __BYTE_ORDER == __LITTLE_ENDIAN
+#define BIT_QUEUE_PACK_AVX2
+#endif
+#include "bit_queue_pack.h"
+#include "bit_queue_internal.h"
+
+/**
+ * @brief The number of words in a packed block of the widest values
+ * @ingroup bit_queue_pack
+ */
+#define BLOCK_WORDS BIT_QUEUE_PACK_MAX_WIDTH
+
+/**
+ * @brief The number of bytes an unpack kernel may read past the end of its block
+ * @ingroup bit_queue_pack
+ */
+#define UNPACK_OVERREAD 32
+
+/**
+ * @brief The number of bits of the width field of a frame header
+ * @ingroup bit_queue_pack
+ */
+#define FRAME_WIDTH_BITS 6
+
+/**
+ * @brief This define expands the given macro for every bit width
+ * @ingroup bit_queue_pack
+ */
+#define FOR_EACH_WIDTH(X) \
+    X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16) \
+    X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31) X(32)
+
+/**
+ * @brief The type of a kernel that packs a block of values into bit_width words
+ * @ingroup bit_queue_pack
+ */
+typedef void (*pack_kernel_t)(const uint32_t *values, uint64_t *words);
+
+/**
+ * @brief The type of a kernel that unpacks a block of values from bit_width little endian words
+ * @ingroup bit_queue_pack
+ */
+typedef void (*unpack_kernel_t)(const uint8_t *packed, uint32_t *values);
+
+/**
+ * @brief This function packs a block of values, called with a constant width so the loop is unrolled to fixed shifts
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param values The block of values
+ * @param words Returns the packed words, the first value in the LSB of the first word
+ * @param width The bit width of the values
+ */
+static inline __attribute__((always_inline)) void bit_queue_pack_block(const uint32_t *values, uint64_t *words, size_t width)
+{
+    size_t i;
+    size_t bit;
+    size_t shift;
+#pragma GCC unroll 64
+    for (i = 0; i < BIT_QUEUE_PACK_BLOCK; i++)
+    {
+        bit = i * width;
+        shift = bit % WINDOW_BITS;
+        if (!shift)
+        {
+            words[bit / WINDOW_BITS] = values[i];
+        }
+        else
+        {
+            words[bit / WINDOW_BITS] |= (uint64_t)values[i] << shift;
+        }
+        // the value spills into the next word
+        if (shift + width > WINDOW_BITS)
+        {
+            words[bit / WINDOW_BITS + 1] = (uint64_t)values[i] >> (WINDOW_BITS - shift);
+        }
+    }
+}
+
+/**
+ * @brief This function unpacks a block of values, called with a constant width so the loop is unrolled to fixed shifts
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param packed The packed words, UNPACK_OVERREAD bytes past the block must be readable
+ * @param values Returns the block of values
+ * @param width The bit width of the values
+ */
+static inline __attribute__((always_inline)) void bit_queue_unpack_block(const uint8_t *packed, uint32_t *values, size_t width)
+{
+#ifdef BIT_QUEUE_PACK_AVX2
+    // every 8 values start on a byte boundary and fit one 32 byte load, each lane picks the two dwords its value
+    // spans and shifts them together
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i bit = _mm256_mullo_epi32(lane, _mm256_set1_epi32(width));
+    const __m256i low = _mm256_srli_epi32(bit, 5);
+    const __m256i high = _mm256_min_epu32(_mm256_add_epi32(low, _mm256_set1_epi32(1)), _mm256_set1_epi32(7));
+    const __m256i shift = _mm256_and_si256(bit, _mm256_set1_epi32(31));
+    const __m256i spill = _mm256_sub_epi32(_mm256_set1_epi32(32), shift);
+    const __m256i mask = _mm256_set1_epi32(width < 32 ? (1U << width) - 1 : UINT32_MAX);
+    __m256i data;
+    __m256i value;
+    size_t i;
+    for (i = 0; i < BIT_QUEUE_PACK_BLOCK / 8; i++)
+    {
+        data = _mm256_loadu_si256((const __m256i *)(packed + i * width));
+        value = _mm256_or_si256(_mm256_srlv_epi32(_mm256_permutevar8x32_epi32(data, low), shift),
+                                _mm256_sllv_epi32(_mm256_permutevar8x32_epi32(data, high), spill));
+        _mm256_storeu_si256((__m256i *)(values + i * 8), _mm256_and_si256(value, mask));
+    }
+#else
+    uint64_t words[BLOCK_WORDS + 1];
+    uint64_t mask = (1ULL << width) - 1;
+    size_t i;
+    size_t bit;
+    size_t shift;
+    memcpy(words, packed, width * sizeof(uint64_t));
+#pragma GCC unroll 64
+    for (i = 0; i < BIT_QUEUE_PACK_BLOCK; i++)
+    {
+        bit = i * width;
+        shift = bit % WINDOW_BITS;
+        values[i] = (le64toh(words[bit / WINDOW_BITS]) >> shift) & mask;
+        if (shift + width > WINDOW_BITS)
+        {
+            values[i] |= (le64toh(words[bit / WINDOW_BITS + 1]) << (WINDOW_BITS - shift)) & mask;
+        }
+    }
+#endif
+}
+
+/**
+ * @brief This define generates the pack and unpack kernels of a bit width
+ * @ingroup bit_queue_pack
+ */
+#define DEFINE_KERNELS(width) \
+    static void bit_queue_pack_##width(const uint32_t *values, uint64_t *words) \
+    { \
+        bit_queue_pack_block(values, words, width); \
+    } \
+    static void bit_queue_unpack_##width(const uint8_t *packed, uint32_t *values) \
+    { \
+        bit_queue_unpack_block(packed, values, width); \
+    }
+
+FOR_EACH_WIDTH(DEFINE_KERNELS)
+
+#define PACK_KERNEL_ENTRY(width) bit_queue_pack_##width,
+#define UNPACK_KERNEL_ENTRY(width) bit_queue_unpack_##width,
+
+/**
+ * @brief The pack kernels indexed by bit width
+ * @ingroup bit_queue_pack
+ */
+static const pack_kernel_t pack_kernels[BIT_QUEUE_PACK_MAX_WIDTH + 1] = {NULL, FOR_EACH_WIDTH(PACK_KERNEL_ENTRY)};
+
+/**
+ * @brief The unpack kernels indexed by bit width
+ * @ingroup bit_queue_pack
+ */
+static const unpack_kernel_t unpack_kernels[BIT_QUEUE_PACK_MAX_WIDTH + 1] = {NULL, FOR_EACH_WIDTH(UNPACK_KERNEL_ENTRY)};
+
+/**
+ * @brief This function validates the arguments of a pack or unpack call
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if an argument is invalid
+ * 2) Sets errno to EMSGSIZE if the packed array is larger than the entire bit queue buffer
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The bit queue
+ * @param values The values
+ * @param count The number of values
+ * @param bit_width The number of bits of each value
+ * @return true if the call is valid false otherwise
+ */
+static bool bit_queue_pack_check(bit_queue_t *bq, const uint32_t *values, size_t count, uint8_t bit_width);
+
+/**
+ * @brief This function writes packed words at the write cursor and advances it without publishing them
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The destination bit queue
+ * @param words The packed words
+ * @param bit_count The number of bits to write
+ */
+static void bit_queue_pack_store(bit_queue_t *bq, const uint64_t *words, size_t bit_count);
+
+/**
+ * @brief This function packs values at the write cursor and advances it without publishing them.
+ * The caller must check that the queue has space for count * bit_width bits.
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The destination bit queue
+ * @param values The values to write, each fits bit_width bits
+ * @param count The number of values
+ * @param bit_width The number of bits of each value (1 - BIT_QUEUE_PACK_MAX_WIDTH)
+ */
+static void bit_queue_pack_put(bit_queue_t *bq, const uint32_t *values, size_t count, uint8_t bit_width);
+
+/**
+ * @brief This function unpacks values at the read cursor and advances it without publishing the read bits.
+ * The caller must check that the queue holds count * bit_width bits.
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The source bit queue
+ * @param values Returns the values read
+ * @param count The number of values
+ * @param bit_width The number of bits of each value (1 - BIT_QUEUE_PACK_MAX_WIDTH)
+ */
+static void bit_queue_pack_get(bit_queue_t *bq, uint32_t *values, size_t count, uint8_t bit_width);
+
+/**
+ * @brief This function computes the residuals of a FOR or delta frame
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param values The values of the frame
+ * @param count The number of values in the frame
+ * @param delta Whether the frame is delta coded
+ * @param residuals Returns the residuals of the frame
+ * @param base Returns the base value of the frame
+ * @return size_t The number of residuals
+ */
+static size_t bit_queue_frame_residuals(const uint32_t *values, size_t count, bool delta, uint32_t *residuals, uint32_t *base);
+
+/**
+ * @brief This function sizes or writes the FOR or delta frames of an array
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The destination bit queue
+ * @param values The values to write
+ * @param count The number of values
+ * @param delta Whether the frames are delta coded
+ * @param store Whether to write the frames at the write cursor (without publishing them) or only size them
+ * @return size_t The number of bits of the frames
+ */
+static size_t bit_queue_put_frames(bit_queue_t *bq, const uint32_t *values, size_t count, bool delta, bool store);
+
+/**
+ * @brief This function walks the frame headers at the read cursor and sums the size of the frames
+ * 
+ * errno options:
+ * 1) Sets errno EBADMSG if a frame header holds a width larger than BIT_QUEUE_PACK_MAX_WIDTH
+ * 2) Sets errno to EMSGSIZE if the frames are larger than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if a frame header isn't in the queue yet
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The source bit queue
+ * @param count The number of values
+ * @param delta Whether the frames are delta coded
+ * @param total Returns the number of bits of the frames
+ * @return true if all of the headers are valid false otherwise
+ */
+static bool bit_queue_frames_size(bit_queue_t *bq, size_t count, bool delta, size_t *total);
+
+/**
+ * @brief This function writes an array of values as FOR or delta coded frames
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if an argument is invalid
+ * 2) Sets errno to EMSGSIZE if the coded array is larger than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The destination bit queue
+ * @param values The values to write
+ * @param count The number of values
+ * @param delta Whether the frames are delta coded
+ * @return int The number of bits written or -1 in failure
+ */
+static int bit_queue_write_frames(bit_queue_t *bq, const uint32_t *values, size_t count, bool delta);
+
+/**
+ * @brief This function reads an array of values coded as FOR or delta frames
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if an argument is invalid
+ * 2) Sets errno EBADMSG if a frame header holds a width larger than BIT_QUEUE_PACK_MAX_WIDTH
+ * 3) Sets errno to EMSGSIZE if the coded array is larger than the entire bit queue buffer
+ * 4) Sets errno to EAGAIN if there isn't enough data in the queue
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The source bit queue
+ * @param values Returns the values read
+ * @param count The number of values
+ * @param delta Whether the frames are delta coded
+ * @return int The number of bits read or -1 in failure
+ */
+static int bit_queue_read_frames(bit_queue_t *bq, uint32_t *values, size_t count, bool delta);
+
+/**
+ * @brief This function decodes zigzag coded differences and sums them onto the base value
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param values Returns the running sums
+ * @param deltas The zigzag coded differences
+ * @param count The number of differences
+ * @param base The value before the first difference
+ */
+static void bit_queue_prefix_sum(uint32_t *values, const uint32_t *deltas, size_t count, uint32_t base);
+
+int bit_queue_pack_u32(bit_queue_t *bq, const uint32_t *values, size_t count, uint8_t bit_width)
+{
+    int ret_val = -1;
+    uint32_t bits = 0;
+    size_t i;
+    if (!bit_queue_pack_check(bq, values, count, bit_width))
+    {
+        // errno is set by bit_queue_pack_check
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
+        {
+            bits |= values[i];
+        }
+        if (bit_width < BIT_QUEUE_PACK_MAX_WIDTH && bits >> bit_width)
+        {
+            errno = ERANGE;
+        }
+        else if (!bit_queue_has_space(bq, count * bit_width))
+        {
+            errno = EAGAIN;
+        }
+        else
+        {
+            bit_queue_pack_put(bq, values, count, bit_width);
+            bit_queue_publish_write(bq, count * bit_width);
+            ret_val = count * bit_width;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_unpack_u32(bit_queue_t *bq, uint32_t *values, size_t count, uint8_t bit_width)
+{
+    int ret_val = -1;
+    if (!bit_queue_pack_check(bq, values, count, bit_width))
+    {
+        // errno is set by bit_queue_pack_check
+    }
+    else if (!bit_queue_has_data(bq, count * bit_width))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        bit_queue_pack_get(bq, values, count, bit_width);
+        bit_queue_publish_read(bq, count * bit_width);
+        ret_val = count * bit_width;
+    }
+    return ret_val;
+}
+
+int bit_queue_write_for_u32(bit_queue_t *bq, const uint32_t *values, size_t count)
+{
+    return bit_queue_write_frames(bq, values, count, false);
+}
+
+int bit_queue_read_for_u32(bit_queue_t *bq, uint32_t *values, size_t count)
+{
+    return bit_queue_read_frames(bq, values, count, false);
+}
+
+int bit_queue_write_delta_u32(bit_queue_t *bq, const uint32_t *values, size_t count)
+{
+    return bit_queue_write_frames(bq, values, count, true);
+}
+
+int bit_queue_read_delta_u32(bit_queue_t *bq, uint32_t *values, size_t count)
+{
+    return bit_queue_read_frames(bq, values, count, true);
+}
+
+// static functions
+
+static void bit_queue_pack_put(bit_queue_t *bq, const uint32_t *values, size_t count, uint8_t bit_width)
+{
+    uint64_t words[BLOCK_WORDS];
+    uint32_t tail[BIT_QUEUE_PACK_BLOCK] = {0};
+    size_t i;
+    for (i = 0; i + BIT_QUEUE_PACK_BLOCK <= count; i += BIT_QUEUE_PACK_BLOCK)
+    {
+        pack_kernels[bit_width](values + i, words);
+        bit_queue_pack_store(bq, words, BIT_QUEUE_PACK_BLOCK * bit_width);
+    }
+    if (i < count)
+    {
+        // the last partial block is padded with zeros and only its values are written
+        memcpy(tail, values + i, (count - i) * sizeof(*values));
+        pack_kernels[bit_width](tail, words);
+        bit_queue_pack_store(bq, words, (count - i) * bit_width);
+    }
+}
+
+static void bit_queue_pack_get(bit_queue_t *bq, uint32_t *values, size_t count, uint8_t bit_width)
+{
+    uint64_t words[BLOCK_WORDS + UNPACK_OVERREAD / sizeof(uint64_t)] = {0};
+    uint32_t tail[BIT_QUEUE_PACK_BLOCK];
+    size_t block_bits = BIT_QUEUE_PACK_BLOCK * bit_width;
+    size_t bits;
+    size_t i;
+    size_t j;
+    for (i = 0; i < count; i += BIT_QUEUE_PACK_BLOCK)
+    {
+        bits = i + BIT_QUEUE_PACK_BLOCK <= count ? block_bits : (count - i) * bit_width;
+        if (bits == block_bits && !bq->r_bit_offset &&
+            bq->r_byte_offset + block_bits / BITS_IN_BYTE + UNPACK_OVERREAD <= bq->buffer_size)
+        {
+            // the block is byte aligned and contiguous, unpack it in place
+            unpack_kernels[bit_width](bq->buffer + bq->r_byte_offset, values + i);
+        }
+        else
+        {
+            // gather the block into words, handling the bit offset and the end of the buffer
+            for (j = 0; j * WINDOW_BITS < bits; j++)
+            {
+                bit_queue_peek_bits(bq, j * WINDOW_BITS, &words[j]);
+                words[j] = htole64(words[j]);
+            }
+            unpack_kernels[bit_width]((const uint8_t *)words, tail);
+            memcpy(values + i, tail, bits / bit_width * sizeof(*values));
+        }
+        bit_queue_advance_read(bq, bits);
+    }
+}
+
+static bool bit_queue_pack_check(bit_queue_t *bq, const uint32_t *values, size_t count, uint8_t bit_width)
+{
+    bool ret_val = false;
+    if (bq == NULL || bq->buffer == NULL || values == NULL || count == 0 || bit_width == 0 || bit_width > BIT_QUEUE_PACK_MAX_WIDTH)
+    {
+        errno = EINVAL;
+    }
+    else if (count > bq->buffer_size * BITS_IN_BYTE / bit_width || count > INT_MAX / bit_width)
+    {
+        errno = EMSGSIZE;
+    }
+    else
+    {
+        ret_val = true;
+    }
+    return ret_val;
+}
+
+static void bit_queue_pack_store(bit_queue_t *bq, const uint64_t *words, size_t bit_count)
+{
+    uint64_t word;
+    size_t i;
+    if (!bq->w_bit_offset && !(bit_count % WINDOW_BITS) &&
+        bq->w_byte_offset + bit_count / BITS_IN_BYTE <= bq->buffer_size)
+    {
+        // the block is byte aligned and contiguous, store the words in place
+        for (i = 0; i < bit_count / WINDOW_BITS; i++)
+        {
+            word = htole64(words[i]);
+            memcpy(bq->buffer + bq->w_byte_offset + i * sizeof(word), &word, sizeof(word));
+        }
+        bit_queue_advance_write(bq, bit_count);
+    }
+    else
+    {
+        for (i = 0; i * WINDOW_BITS < bit_count; i++)
+        {
+            bit_queue_put_bits(bq, words[i], bit_count - i * WINDOW_BITS < WINDOW_BITS ? bit_count - i * WINDOW_BITS : WINDOW_BITS);
+        }
+    }
+}
+
+static size_t bit_queue_frame_residuals(const uint32_t *values, size_t count, bool delta, uint32_t *residuals, uint32_t *base)
+{
+    uint32_t min = values[0];
+    int32_t diff;
+    size_t i;
+    if (delta)
+    {
+        *base = values[0];
+        for (i = 1; i < count; i++)
+        {
+            diff = (int32_t)(values[i] - values[i - 1]);
+            residuals[i - 1] = ((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31);
+        }
+        count--;
+    }
+    else
+    {
+        for (i = 1; i < count; i++)
+        {
+            min = values[i] < min ? values[i] : min;
+        }
+        *base = min;
+        for (i = 0; i < count; i++)
+        {
+            residuals[i] = values[i] - min;
+        }
+    }
+    return count;
+}
+
+static size_t bit_queue_put_frames(bit_queue_t *bq, const uint32_t *values, size_t count, bool delta, bool store)
+{
+    uint32_t residuals[BIT_QUEUE_FRAME_VALUES];
+    uint32_t base;
+    uint32_t bits;
+    uint8_t width;
+    size_t frame;
+    size_t n;
+    size_t i;
+    size_t total = 0;
+    for (frame = 0; frame < count; frame += BIT_QUEUE_FRAME_VALUES)
+    {
+        n = count - frame < BIT_QUEUE_FRAME_VALUES ? count - frame : BIT_QUEUE_FRAME_VALUES;
+        n = bit_queue_frame_residuals(values + frame, n, delta, residuals, &base);
+        for (i = 0, bits = 0; i < n; i++)
+        {
+            bits |= residuals[i];
+        }
+        width = bits ? BIT_QUEUE_PACK_MAX_WIDTH - __builtin_clz(bits) : 0;
+        if (store)
+        {
+            bit_queue_put_bits(bq, width | ((uint64_t)base << FRAME_WIDTH_BITS), BIT_QUEUE_FRAME_HEADER_BITS);
+            if (width)
+            {
+                bit_queue_pack_put(bq, residuals, n, width);
+            }
+        }
+        total += BIT_QUEUE_FRAME_HEADER_BITS + n * width;
+    }
+    return total;
+}
+
+static bool bit_queue_frames_size(bit_queue_t *bq, size_t count, bool delta, size_t *total)
+{
+    uint64_t header;
+    uint8_t width;
+    size_t frame;
+    size_t n;
+    *total = 0;
+    for (frame = 0; frame < count; frame += BIT_QUEUE_FRAME_VALUES)
+    {
+        n = count - frame < BIT_QUEUE_FRAME_VALUES ? count - frame : BIT_QUEUE_FRAME_VALUES;
+        n -= delta;
+        if (*total + BIT_QUEUE_FRAME_HEADER_BITS > bq->buffer_size * BITS_IN_BYTE)
+        {
+            errno = EMSGSIZE;
+            break;
+        }
+        else if (bit_queue_peek_bits(bq, *total, &header) < BIT_QUEUE_FRAME_HEADER_BITS)
+        {
+            errno = EAGAIN;
+            break;
+        }
+        else if ((width = header & ((1 << FRAME_WIDTH_BITS) - 1)) > BIT_QUEUE_PACK_MAX_WIDTH)
+        {
+            errno = EBADMSG;
+            break;
+        }
+        *total += BIT_QUEUE_FRAME_HEADER_BITS + n * width;
+    }
+    return frame >= count;
+}
+
+static int bit_queue_write_frames(bit_queue_t *bq, const uint32_t *values, size_t count, bool delta)
+{
+    int ret_val = -1;
+    size_t total;
+    if (bq == NULL || bq->buffer == NULL || values == NULL || count == 0)
+    {
+        errno = EINVAL;
+    }
+    // the frames are sized first so either all of them are written or none
+    else if ((total = bit_queue_put_frames(bq, values, count, delta, false)) > bq->buffer_size * BITS_IN_BYTE || total > INT_MAX)
+    {
+        errno = EMSGSIZE;
+    }
+    else if (!bit_queue_has_space(bq, total))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        bit_queue_put_frames(bq, values, count, delta, true);
+        bit_queue_publish_write(bq, total);
+        ret_val = total;
+    }
+    return ret_val;
+}
+
+static int bit_queue_read_frames(bit_queue_t *bq, uint32_t *values, size_t count, bool delta)
+{
+    int ret_val = -1;
+    uint32_t residuals[BIT_QUEUE_FRAME_VALUES];
+    uint64_t header;
+    uint32_t base;
+    uint8_t width;
+    size_t frame;
+    size_t total;
+    size_t n;
+    size_t i;
+    if (bq == NULL || bq->buffer == NULL || values == NULL || count == 0)
+    {
+        errno = EINVAL;
+    }
+    else if (!bit_queue_frames_size(bq, count, delta, &total))
+    {
+        // errno is set by bit_queue_frames_size
+    }
+    else if (total > bq->buffer_size * BITS_IN_BYTE || total > INT_MAX)
+    {
+        errno = EMSGSIZE;
+    }
+    else if (!bit_queue_has_data(bq, total))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        for (frame = 0; frame < count; frame += BIT_QUEUE_FRAME_VALUES)
+        {
+            n = count - frame < BIT_QUEUE_FRAME_VALUES ? count - frame : BIT_QUEUE_FRAME_VALUES;
+            bit_queue_peek_bits(bq, 0, &header);
+            bit_queue_advance_read(bq, BIT_QUEUE_FRAME_HEADER_BITS);
+            width = header & ((1 << FRAME_WIDTH_BITS) - 1);
+            base = header >> FRAME_WIDTH_BITS;
+            if (width)
+            {
+                bit_queue_pack_get(bq, residuals, n - delta, width);
+            }
+            else
+            {
+                memset(residuals, 0, (n - delta) * sizeof(*residuals));
+            }
+            if (delta)
+            {
+                values[frame] = base;
+                bit_queue_prefix_sum(values + frame + 1, residuals, n - 1, base);
+            }
+            else
+            {
+                for (i = 0; i < n; i++)
+                {
+                    values[frame + i] = base + residuals[i];
+                }
+            }
+        }
+        bit_queue_publish_read(bq, total);
+        ret_val = total;
+    }
+    return ret_val;
+}
+
+static void bit_queue_prefix_sum(uint32_t *values, const uint32_t *deltas, size_t count, uint32_t base)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i sum = _mm_set1_epi32(base);
+    __m128i x;
+    for (; i + 4 <= count; i += 4)
+    {
+        // unzigzag, scan the 4 lanes in two shifted adds and add the last sum of the previous lanes
+        x = _mm_loadu_si128((const __m128i *)(deltas + i));
+        x = _mm_xor_si128(_mm_srli_epi32(x, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(x, one)));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        sum = _mm_add_epi32(x, sum);
+        _mm_storeu_si128((__m128i *)(values + i), sum);
+        sum = _mm_shuffle_epi32(sum, 0xff);
+    }
+    base = i ? values[i - 1] : base;
+#endif
+    for (; i < count; i++)
+    {
+        base += (deltas[i] >> 1) ^ -(deltas[i] & 1);
+        values[i] = base;
+    }
+}
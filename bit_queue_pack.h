@@ -0,0 +1,182 @@
+/**
+ * @file bit_queue_pack.h
+ * @author amitfr1
+ * @brief Fixed width bit packing of integer arrays over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_pack
+ * This module packs arrays of integers at a fixed number of bits per value directly into the bit queue buffer.
+ * Value i of the array is written to bits [i * bit_width, (i + 1) * bit_width) of the packed stream in the queue
+ * bit order, so a packed array can be read back one value at a time with bit_queue_read_bits.
+ * The values are packed in blocks of BIT_QUEUE_PACK_BLOCK values by kernels generated for every bit width.
+ * 
+ * The frame of reference (FOR) and delta codecs split the array into frames of BIT_QUEUE_FRAME_VALUES values.
+ * Every frame starts with a header of BIT_QUEUE_FRAME_HEADER_BITS bits holding the bit width of the frame
+ * (6 bits) and its base value (32 bits), followed by the packed residuals of the frame:
+ * - FOR: the base is the smallest value of the frame and the residuals are value - base.
+ * - delta: the base is the first value of the frame and the residuals are the zigzag coded differences between
+ *   consecutive values, so sorted streams pack into a few bits per value and unsorted streams are still valid.
+ * A frame whose residuals are all zero has a width of 0 and no packed bits.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "bit_queue.h"
+
+#ifndef BIT_QUEUE_PACK_H_
+#define BIT_QUEUE_PACK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The number of values handled by one pack or unpack kernel call
+ * @ingroup bit_queue_pack
+ */
+#define BIT_QUEUE_PACK_BLOCK 64
+
+/**
+ * @brief The largest bit width of a packed value
+ * @ingroup bit_queue_pack
+ */
+#define BIT_QUEUE_PACK_MAX_WIDTH 32
+
+/**
+ * @brief The number of values in a FOR or delta frame
+ * @ingroup bit_queue_pack
+ */
+#define BIT_QUEUE_FRAME_VALUES 256
+
+/**
+ * @brief The number of bits in a FOR or delta frame header
+ * @ingroup bit_queue_pack
+ */
+#define BIT_QUEUE_FRAME_HEADER_BITS 38
+
+/**
+ * @brief This function packs an array of values at bit_width bits each into the bit queue.
+ * Either all of the values are written or none of them.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or values = NULL or count = 0
+ *    or bit_width isn't in the range 1 - BIT_QUEUE_PACK_MAX_WIDTH
+ * 2) Sets errno ERANGE if one of the values doesn't fit bit_width bits
+ * 3) Sets errno to EMSGSIZE if the packed array is larger than the entire bit queue buffer
+ * 4) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The destination bit queue
+ * @param values The values to write
+ * @param count The number of values
+ * @param bit_width The number of bits of each value
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_pack_u32(bit_queue_t *bq, const uint32_t *values, size_t count, uint8_t bit_width);
+
+/**
+ * @brief This function unpacks an array of values of bit_width bits each from the bit queue.
+ * Either all of the values are read or none of them.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or values = NULL or count = 0
+ *    or bit_width isn't in the range 1 - BIT_QUEUE_PACK_MAX_WIDTH
+ * 2) Sets errno to EMSGSIZE if the packed array is larger than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if there isn't enough data in the queue
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The source bit queue
+ * @param values Returns the values read
+ * @param count The number of values
+ * @param bit_width The number of bits of each value
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_unpack_u32(bit_queue_t *bq, uint32_t *values, size_t count, uint8_t bit_width);
+
+/**
+ * @brief This function writes an array of values as frame of reference coded frames.
+ * Either all of the frames are written or none of them.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or values = NULL or count = 0
+ * 2) Sets errno to EMSGSIZE if the coded array is larger than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The destination bit queue
+ * @param values The values to write
+ * @param count The number of values
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_for_u32(bit_queue_t *bq, const uint32_t *values, size_t count);
+
+/**
+ * @brief This function reads an array of values written by bit_queue_write_for_u32.
+ * Either all of the frames are read or none of them.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or values = NULL or count = 0
+ * 2) Sets errno EBADMSG if a frame header holds a width larger than BIT_QUEUE_PACK_MAX_WIDTH
+ * 3) Sets errno to EMSGSIZE if the coded array is larger than the entire bit queue buffer
+ * 4) Sets errno to EAGAIN if there isn't enough data in the queue
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The source bit queue
+ * @param values Returns the values read
+ * @param count The number of values, the count given to bit_queue_write_for_u32
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_for_u32(bit_queue_t *bq, uint32_t *values, size_t count);
+
+/**
+ * @brief This function writes an array of values as delta coded frames.
+ * Either all of the frames are written or none of them.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or values = NULL or count = 0
+ * 2) Sets errno to EMSGSIZE if the coded array is larger than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The destination bit queue
+ * @param values The values to write
+ * @param count The number of values
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_delta_u32(bit_queue_t *bq, const uint32_t *values, size_t count);
+
+/**
+ * @brief This function reads an array of values written by bit_queue_write_delta_u32.
+ * The differences are summed with a SIMD prefix sum.
+ * Either all of the frames are read or none of them.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or values = NULL or count = 0
+ * 2) Sets errno EBADMSG if a frame header holds a width larger than BIT_QUEUE_PACK_MAX_WIDTH
+ * 3) Sets errno to EMSGSIZE if the coded array is larger than the entire bit queue buffer
+ * 4) Sets errno to EAGAIN if there isn't enough data in the queue
+ * 
+ * @ingroup bit_queue_pack
+ * 
+ * @param bq The source bit queue
+ * @param values Returns the values read
+ * @param count The number of values, the count given to bit_queue_write_delta_u32
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_delta_u32(bit_queue_t *bq, uint32_t *values, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_PACK_H_
@@ -0,0 +1,247 @@
+/**
+ * @file bit_queue_reference.c
+ * @author amitfr1
+ * @brief A bit by bit reference model of the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @ingroup bit_queue_reference
+ *
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include "bit_queue_reference.h"
+
+/**
+ * @brief This function returns bit index of the buffer
+ * @ingroup bit_queue_reference
+ */
+static uint8_t bit_queue_ref_get(const uint8_t *buffer, size_t index);
+
+/**
+ * @brief This function sets bit index of the buffer to value
+ * @ingroup bit_queue_reference
+ */
+static void bit_queue_ref_set(uint8_t *buffer, size_t index, uint8_t value);
+
+/**
+ * @brief This function appends a bit to the model, the caller checks the space
+ * @ingroup bit_queue_reference
+ */
+static void bit_queue_ref_push(bit_queue_ref_t *ref, uint8_t bit);
+
+/**
+ * @brief This function removes the oldest bit of the model, the caller checks the data
+ * @ingroup bit_queue_reference
+ */
+static uint8_t bit_queue_ref_pop(bit_queue_ref_t *ref);
+
+int bit_queue_ref_init(bit_queue_ref_t *ref, size_t byte_count)
+{
+    int ret_val = -1;
+    if (ref == NULL || byte_count == 0)
+    {
+        errno = EINVAL;
+    }
+    else if (!(ref->bits = calloc(byte_count, 8)))
+    {
+        // errno is set by calloc
+    }
+    else
+    {
+        ref->capacity = byte_count * 8;
+        ref->head = 0;
+        ref->count = 0;
+        ret_val = 0;
+    }
+    return ret_val;
+}
+
+int bit_queue_ref_init_full(bit_queue_ref_t *ref, const uint8_t *buffer, size_t byte_count)
+{
+    int ret_val = -1;
+    size_t i;
+    if (buffer == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if (bit_queue_ref_init(ref, byte_count) == -1)
+    {
+        // errno is set by bit_queue_ref_init
+    }
+    else
+    {
+        for (i = 0; i < byte_count * 8; i++)
+        {
+            bit_queue_ref_push(ref, bit_queue_ref_get(buffer, i));
+        }
+        ret_val = 0;
+    }
+    return ret_val;
+}
+
+void bit_queue_ref_destroy(bit_queue_ref_t *ref)
+{
+    if (ref != NULL)
+    {
+        free(ref->bits);
+        ref->bits = NULL;
+    }
+}
+
+int bit_queue_ref_read_bits(bit_queue_ref_t *ref, uint8_t *buffer, size_t buffer_size, size_t bit_count)
+{
+    int ret_val = -1;
+    size_t i;
+    if (ref == NULL || ref->bits == NULL || buffer == NULL || bit_count == 0 || buffer_size * 8 < bit_count)
+    {
+        errno = EINVAL;
+    }
+    else if (bit_count > ref->capacity)
+    {
+        errno = EMSGSIZE;
+    }
+    else if (bit_count > ref->count)
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        for (i = 0; i < bit_count; i++)
+        {
+            bit_queue_ref_set(buffer, i, bit_queue_ref_pop(ref));
+        }
+        ret_val = bit_count;
+    }
+    return ret_val;
+}
+
+int bit_queue_ref_write_bits(bit_queue_ref_t *ref, const uint8_t *buffer, size_t buffer_size, size_t bit_count)
+{
+    return bit_queue_ref_write_bits_multi(&ref, 1, buffer, buffer_size, bit_count);
+}
+
+int bit_queue_ref_write_bits_multi(bit_queue_ref_t **refs, size_t count, const uint8_t *buffer, size_t buffer_size, size_t bit_count)
+{
+    int ret_val = -1;
+    bool valid = refs != NULL && count > 0 && buffer != NULL && bit_count > 0 && buffer_size * 8 >= bit_count;
+    size_t i, j;
+    if (!valid)
+    {
+        errno = EINVAL;
+    }
+    // the first model that can't take the bits decides the error
+    for (i = 0; valid && i < count; i++)
+    {
+        valid = false;
+        if (refs[i] == NULL || refs[i]->bits == NULL)
+        {
+            errno = EINVAL;
+        }
+        else if (bit_count > refs[i]->capacity)
+        {
+            errno = EMSGSIZE;
+        }
+        else if (bit_count > refs[i]->capacity - refs[i]->count)
+        {
+            errno = EAGAIN;
+        }
+        else
+        {
+            valid = true;
+        }
+    }
+    for (i = 0; valid && i < count; i++)
+    {
+        for (j = 0; j < bit_count; j++)
+        {
+            bit_queue_ref_push(refs[i], bit_queue_ref_get(buffer, j));
+        }
+        ret_val = bit_count;
+    }
+    return ret_val;
+}
+
+int bit_queue_ref_transfer(bit_queue_ref_t *dst, bit_queue_ref_t *src, size_t bit_count)
+{
+    int ret_val = -1;
+    size_t i;
+    if (dst == NULL || src == NULL || dst == src || bit_count == 0 || dst->bits == NULL || src->bits == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if (bit_count > dst->capacity || bit_count > src->capacity)
+    {
+        errno = EMSGSIZE;
+    }
+    else if (bit_count > src->count || bit_count > dst->capacity - dst->count)
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        for (i = 0; i < bit_count; i++)
+        {
+            bit_queue_ref_push(dst, bit_queue_ref_pop(src));
+        }
+        ret_val = bit_count;
+    }
+    return ret_val;
+}
+
+int bit_queue_ref_bit_copy(uint8_t *dst_buff, const uint8_t *src_buff, size_t dst_byte_offset, size_t dst_bit_offset, size_t dst_buff_size, size_t src_byte_offset, size_t src_bit_offset, size_t src_buff_size, size_t bit_count)
+{
+    int ret_val = -1;
+    size_t src_left;
+    size_t i;
+    if (dst_buff == NULL || src_buff == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if (bit_count == 0 || dst_bit_offset >= 8 || src_bit_offset >= 8 || dst_buff_size * 8 < dst_byte_offset * 8 + dst_bit_offset ||
+             src_buff_size * 8 <= src_byte_offset * 8 + src_bit_offset || src_buff_size * 8 < bit_count)
+    {
+        errno = EINVAL;
+    }
+    else if ((dst_buff_size - dst_byte_offset) * 8 - dst_bit_offset < bit_count)
+    {
+        errno = EMSGSIZE;
+    }
+    else
+    {
+        src_left = (src_buff_size - src_byte_offset) * 8 - src_bit_offset;
+        bit_count = bit_count < src_left ? bit_count : src_left;
+        for (i = 0; i < bit_count; i++)
+        {
+            bit_queue_ref_set(dst_buff, dst_byte_offset * 8 + dst_bit_offset + i, bit_queue_ref_get(src_buff, src_byte_offset * 8 + src_bit_offset + i));
+        }
+        ret_val = bit_count;
+    }
+    return ret_val;
+}
+
+// static functions
+
+static uint8_t bit_queue_ref_get(const uint8_t *buffer, size_t index)
+{
+    return (buffer[index / 8] >> (index % 8)) & 1;
+}
+
+static void bit_queue_ref_set(uint8_t *buffer, size_t index, uint8_t value)
+{
+    buffer[index / 8] = (buffer[index / 8] & ~(1 << (index % 8))) | (value << (index % 8));
+}
+
+static void bit_queue_ref_push(bit_queue_ref_t *ref, uint8_t bit)
+{
+    ref->bits[(ref->head + ref->count) % ref->capacity] = bit;
+    ref->count++;
+}
+
+static uint8_t bit_queue_ref_pop(bit_queue_ref_t *ref)
+{
+    uint8_t bit = ref->bits[ref->head];
+    ref->head = (ref->head + 1) % ref->capacity;
+    ref->count--;
+    return bit;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file bit_queue_reference.h
+ * @author amitfr1
+ * @brief A bit by bit reference model of the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_reference
+ * This module is the specification the optimized bit queue is tested against. It keeps one byte per bit and moves
+ * the bits one at a time with no shifting or masking, so it is slow and easy to check by reading.
+ * The functions return the same values and set the same errno as the bit queue functions they model.
+ * Bits are taken from and put into the buffers least significant bit first, the other bits of a buffer are left as
+ * they were.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifndef BIT_QUEUE_REFERENCE_H_
+#define BIT_QUEUE_REFERENCE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The reference model of a bit queue
+ * @ingroup bit_queue_reference
+ */
+typedef struct bit_queue_ref
+{
+    uint8_t * bits; /// One byte per bit of the ring
+    size_t capacity; /// The number of bits in the ring
+    size_t head; /// The index of the oldest bit
+    size_t count; /// The number of bits in the queue
+} bit_queue_ref_t;
+
+/**
+ * @brief This function initializes an empty model of a queue of byte_count bytes
+ *
+ * errno options:
+ * 1) Sets errno EINVAL if ref = NULL or byte_count = 0
+ * 2) The errno is set by the allocation method
+ *
+ * @ingroup bit_queue_reference
+ *
+ * @param ref The model
+ * @param byte_count The size of the modeled queue in bytes
+ *
+ * @return int 0 or -1 in failure
+ */
+int bit_queue_ref_init(bit_queue_ref_t *ref, size_t byte_count);
+
+/**
+ * @brief This function initializes a model of a queue that starts full of the bits of buffer, like bit_queue_init
+ *
+ * errno options:
+ * 1) Sets errno EINVAL if ref = NULL or buffer = NULL or byte_count = 0
+ * 2) The errno is set by the allocation method
+ *
+ * @ingroup bit_queue_reference
+ *
+ * @param ref The model
+ * @param buffer The initial content
+ * @param byte_count The size of the buffer in bytes
+ *
+ * @return int 0 or -1 in failure
+ */
+int bit_queue_ref_init_full(bit_queue_ref_t *ref, const uint8_t *buffer, size_t byte_count);
+
+/**
+ * @brief This function frees the model
+ *
+ * @ingroup bit_queue_reference
+ *
+ * @param ref The model
+ */
+void bit_queue_ref_destroy(bit_queue_ref_t *ref);
+
+/**
+ * @brief The model of bit_queue_read_bits
+ *
+ * @ingroup bit_queue_reference
+ *
+ * @param ref The model
+ * @param buffer The destination buffer
+ * @param buffer_size The size of the buffer
+ * @param bit_count The amount of bits to read
+ *
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_ref_read_bits(bit_queue_ref_t *ref, uint8_t *buffer, size_t buffer_size, size_t bit_count);
+
+/**
+ * @brief The model of bit_queue_write_bits
+ *
+ * @ingroup bit_queue_reference
+ *
+ * @param ref The model
+ * @param buffer The source buffer
+ * @param buffer_size The size of the buffer
+ * @param bit_count The amount of bits to write
+ *
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_ref_write_bits(bit_queue_ref_t *ref, const uint8_t *buffer, size_t buffer_size, size_t bit_count);
+
+/**
+ * @brief The model of bit_queue_write_bits_multi
+ *
+ * @ingroup bit_queue_reference
+ *
+ * @param refs The models
+ * @param count The number of models
+ * @param buffer The source buffer
+ * @param buffer_size The size of the buffer
+ * @param bit_count The amount of bits to write
+ *
+ * @return int The number of bits written to each model or -1 in failure
+ */
+int bit_queue_ref_write_bits_multi(bit_queue_ref_t **refs, size_t count, const uint8_t *buffer, size_t buffer_size, size_t bit_count);
+
+/**
+ * @brief The model of bit_queue_transfer
+ *
+ * @ingroup bit_queue_reference
+ *
+ * @param dst The destination model
+ * @param src The source model
+ * @param bit_count The amount of bits to move
+ *
+ * @return int The number of bits moved or -1 in failure
+ */
+int bit_queue_ref_transfer(bit_queue_ref_t *dst, bit_queue_ref_t *src, size_t bit_count);
+
+/**
+ * @brief The model of the internal bit_queue_bit_buffer_copy, the copy is clamped to the bits left in the source
+ *
+ * errno options:
+ * 1) Sets errno EINVAL if a buffer is NULL, bit_count = 0, the destination offset is past its buffer, no source bits
+ *    are left after the source offset or the source is smaller than bit_count
+ * 2) Sets errno to EMSGSIZE if the bits left in the destination are fewer than bit_count
+ *
+ * @ingroup bit_queue_reference
+ *
+ * @return int The number of bits copied or -1 in failure
+ */
+int bit_queue_ref_bit_copy(uint8_t *dst_buff, const uint8_t *src_buff, size_t dst_byte_offset, size_t dst_bit_offset, size_t dst_buff_size, size_t src_byte_offset, size_t src_bit_offset, size_t src_buff_size, size_t bit_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_REFERENCE_H_
@@ -0,0 +1,265 @@
+/**
+ * @file bit_queue_schema.hpp
+ * @author amitfr1
+ * @brief Compile time bit field layouts of messages over the C++ bit queue wrapper
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_schema
+ * A message type lists its fields and their widths once:
+ *
+ *     struct header
+ *     {
+ *         uint8_t version;
+ *         bool urgent;
+ *         int16_t delta;
+ *         using schema = bit_queue::schema<bit_queue::field<&header::version, 3>, bit_queue::field<&header::urgent, 1>,
+ *                                          bit_queue::field<&header::delta, 12>>;
+ *     };
+ *
+ * The fields are laid out back to back from the first one, in the order the queue carries them, so the first field
+ * is in the low bits of the first 64 bit word. The offset of every field is a constant, encoding ORs each field into
+ * its word with a constant shift and decoding extracts it with a constant shift and mask, a field that crosses a word
+ * takes one more constant shift. The whole message is one queue transfer (the inline fast path up to 64 bits) so
+ * it is written or read entirely or not at all.
+ * Fields may be integers, bool or enums, the bits above the width are dropped and signed fields are sign extended.
+ */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "bit_queue.hpp"
+
+#ifndef BIT_QUEUE_SCHEMA_HPP_
+#define BIT_QUEUE_SCHEMA_HPP_
+
+namespace bit_queue
+{
+
+/**
+ * @brief The class and the value type of a pointer to a data member
+ * @ingroup bit_queue_schema
+ */
+template <typename T>
+struct member_pointer_traits;
+
+template <typename Class, typename Value>
+struct member_pointer_traits<Value Class::*>
+{
+    using class_type = Class;
+    using value_type = Value;
+};
+
+/**
+ * @brief A field of a message, the member Member is carried in its Width low bits
+ * @ingroup bit_queue_schema
+ */
+template <auto Member, unsigned Width>
+struct field
+{
+    using message_type = typename member_pointer_traits<decltype(Member)>::class_type;
+    using value_type = typename member_pointer_traits<decltype(Member)>::value_type;
+    using integer_type = typename std::conditional_t<std::is_enum_v<value_type>, std::underlying_type<value_type>,
+                                                     std::enable_if<true, value_type>>::type;
+
+    static_assert(std::is_integral_v<integer_type>, "a field is an integer, bool or enum member");
+    static_assert(Width >= 1 && Width <= 64, "a field is 1 - 64 bits");
+
+    static constexpr unsigned width = Width;
+    static constexpr uint64_t mask = Width < 64 ? (1ULL << Width) - 1 : ~0ULL;
+
+    /**
+     * @brief This function returns the bits of the field in the low bits
+     */
+    static constexpr uint64_t get(const message_type &message)
+    {
+        return static_cast<uint64_t>(static_cast<integer_type>(message.*Member)) & mask;
+    }
+
+    /**
+     * @brief This function sets the field from its bits, a signed field is sign extended from bit Width - 1
+     */
+    static constexpr void set(message_type &message, uint64_t bits)
+    {
+        if constexpr (std::is_signed_v<integer_type> && Width < 64)
+        {
+            bits = (bits ^ (1ULL << (Width - 1))) - (1ULL << (Width - 1));
+        }
+        message.*Member = static_cast<value_type>(static_cast<integer_type>(bits));
+    }
+};
+
+/**
+ * @brief The layout of a message made of Fields, see the module description
+ * @ingroup bit_queue_schema
+ */
+template <typename... Fields>
+class schema
+{
+public:
+    static_assert(sizeof...(Fields) > 0, "a schema has at least one field");
+
+    using message_type = typename std::tuple_element_t<0, std::tuple<Fields...>>::message_type;
+
+    static_assert((std::is_same_v<typename Fields::message_type, message_type> && ...), "the fields are members of one message type");
+
+    /**
+     * @brief The number of bits of a message in the queue
+     */
+    static constexpr size_t bits = (size_t{Fields::width} + ...);
+
+    /**
+     * @brief The number of 64 bit words that hold a message
+     */
+    static constexpr size_t words = (bits + 63) / 64;
+
+    /**
+     * @brief This function lays the fields of a message in words, the first field in the low bits of the first word
+     */
+    static constexpr std::array<uint64_t, words> encode(const message_type &message)
+    {
+        std::array<uint64_t, words> ret_val = {};
+        encode_fields(message, ret_val, std::index_sequence_for<Fields...>{});
+        return ret_val;
+    }
+
+    /**
+     * @brief This function sets the fields of a message from its words
+     */
+    static constexpr void decode(const std::array<uint64_t, words> &packed, message_type &message)
+    {
+        decode_fields(packed, message, std::index_sequence_for<Fields...>{});
+    }
+
+    /**
+     * @brief This function writes a message to the queue in one transfer
+     * @return true if the message was written or false if the queue doesn't have the space
+     * @throws std::system_error when the write fails for any other reason
+     */
+    static bool write(queue &q, const message_type &message)
+    {
+        bool ret_val;
+        std::array<uint64_t, words> packed = encode(message);
+        if constexpr (bits <= 64)
+        {
+            ret_val = q.write<bits>(static_cast<uint_bits_t<bits>>(packed[0]));
+        }
+        else
+        {
+            uint8_t bytes[words * sizeof(uint64_t)];
+            to_bytes(packed, bytes);
+            ret_val = q.write_bits(bytes, sizeof(bytes), bits);
+        }
+        return ret_val;
+    }
+
+    /**
+     * @brief This function reads a message from the queue in one transfer
+     * @return true if the message was read or false if the queue doesn't hold a whole message
+     * @throws std::system_error when the read fails for any other reason
+     */
+    static bool read(queue &q, message_type &message)
+    {
+        bool ret_val;
+        std::array<uint64_t, words> packed = {};
+        if constexpr (bits <= 64)
+        {
+            std::optional<uint_bits_t<bits>> value = q.read<bits>();
+            if ((ret_val = value.has_value()))
+            {
+                packed[0] = *value;
+            }
+        }
+        else
+        {
+            uint8_t bytes[words * sizeof(uint64_t)] = {};
+            if ((ret_val = q.read_bits(bytes, sizeof(bytes), bits)))
+            {
+                from_bytes(bytes, packed);
+            }
+        }
+        if (ret_val)
+        {
+            decode(packed, message);
+        }
+        return ret_val;
+    }
+
+private:
+    /**
+     * @brief The offset of the field at index in the message, the sum of the widths before it
+     */
+    static constexpr size_t offset(size_t index)
+    {
+        constexpr unsigned widths[] = {Fields::width...};
+        size_t ret_val = 0;
+        for (size_t i = 0; i < index; i++)
+        {
+            ret_val += widths[i];
+        }
+        return ret_val;
+    }
+
+    template <typename Field, size_t Offset>
+    static constexpr void encode_field(const message_type &message, std::array<uint64_t, words> &packed)
+    {
+        uint64_t bits = Field::get(message);
+        packed[Offset / 64] |= bits << (Offset % 64);
+        if constexpr (Offset % 64 + Field::width > 64)
+        {
+            // the field continues in the next word
+            packed[Offset / 64 + 1] |= bits >> (64 - Offset % 64);
+        }
+    }
+
+    template <typename Field, size_t Offset>
+    static constexpr void decode_field(const std::array<uint64_t, words> &packed, message_type &message)
+    {
+        uint64_t bits = packed[Offset / 64] >> (Offset % 64);
+        if constexpr (Offset % 64 + Field::width > 64)
+        {
+            // the field continues in the next word
+            bits |= packed[Offset / 64 + 1] << (64 - Offset % 64);
+        }
+        Field::set(message, bits & Field::mask);
+    }
+
+    template <size_t... I>
+    static constexpr void encode_fields(const message_type &message, std::array<uint64_t, words> &packed, std::index_sequence<I...>)
+    {
+        (encode_field<Fields, offset(I)>(message, packed), ...);
+    }
+
+    template <size_t... I>
+    static constexpr void decode_fields(const std::array<uint64_t, words> &packed, message_type &message, std::index_sequence<I...>)
+    {
+        (decode_field<Fields, offset(I)>(packed, message), ...);
+    }
+
+    static void to_bytes(const std::array<uint64_t, words> &packed, uint8_t *bytes)
+    {
+        uint64_t word;
+        for (size_t i = 0; i < words; i++)
+        {
+            word = BIT_QUEUE_INLINE_LE64(packed[i]);
+            std::memcpy(bytes + i * sizeof(word), &word, sizeof(word));
+        }
+    }
+
+    static void from_bytes(const uint8_t *bytes, std::array<uint64_t, words> &packed)
+    {
+        uint64_t word;
+        for (size_t i = 0; i < words; i++)
+        {
+            std::memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+            packed[i] = BIT_QUEUE_INLINE_LE64(word);
+        }
+    }
+};
+
+} // namespace bit_queue
+
+#endif /// BIT_QUEUE_SCHEMA_HPP_
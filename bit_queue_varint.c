@@ -0,0 +1,479 @@
+/**
+ * @file bit_queue_varint.c
+ * @author amitfr1
+ * @brief Variable length integer codes over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ */
+#include <errno.h>
+#include <string.h>
+#include <endian.h>
+#if defined(__SSE2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#include "bit_queue_varint.h"
+#include "bit_queue_internal.h"
+
+/**
+ * @brief The number of value bits in a LEB128 group
+ * @ingroup bit_queue_varint
+ */
+#define GROUP_VALUE_BITS 7
+
+/**
+ * @brief The maximal number of groups in a 64 bit LEB128 code
+ * @ingroup bit_queue_varint
+ */
+#define LEB128_MAX_GROUPS 10
+
+/**
+ * @brief The number of groups in a window
+ * @ingroup bit_queue_varint
+ */
+#define WINDOW_GROUPS (WINDOW_BITS / BITS_IN_BYTE)
+
+/**
+ * @brief The continuation bits of the groups in a window
+ * @ingroup bit_queue_varint
+ */
+#define CONTINUATION_MASK 0x8080808080808080ULL
+
+/**
+ * @brief The value bits of the groups in a window
+ * @ingroup bit_queue_varint
+ */
+#define VALUE_MASK 0x7f7f7f7f7f7f7f7fULL
+
+/**
+ * @brief The number of groups scanned at once by the batched decoder
+ * @ingroup bit_queue_varint
+ */
+#define SCAN_GROUPS 16
+
+/**
+ * @brief This define creates a mask of the given number of groups (at most WINDOW_GROUPS)
+ * @ingroup bit_queue_varint
+ */
+#define GROUPS_MASK(groups) ((groups) < WINDOW_GROUPS ? (1ULL << ((groups) * BITS_IN_BYTE)) - 1 : ~0ULL)
+
+/**
+ * @brief This function packs the value bits of the first groups of a window together
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param window The groups, the first group in the low bits
+ * @param groups The number of groups to pack (at most WINDOW_GROUPS)
+ * @return uint64_t The packed value bits
+ */
+static uint64_t bit_queue_varint_compact(uint64_t window, size_t groups);
+
+/**
+ * @brief This function decodes the LEB128 code at the read cursor without consuming it
+ * 
+ * errno options:
+ * 1) Sets errno EBADMSG if the code is longer than 10 groups or an unsigned code doesn't fit 64 bits
+ * 2) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param bq The source bit queue
+ * @param value Returns the decoded value bits
+ * @param is_signed Whether the value is sign extended from its last group
+ * @return int The length of the code in bits or -1 in failure
+ */
+static int bit_queue_leb128_peek(bit_queue_t *bq, uint64_t *value, bool is_signed);
+
+/**
+ * @brief This function writes LEB128 groups
+ * 
+ * errno options:
+ * 1) Sets errno to EMSGSIZE if the groups are longer than the entire bit queue buffer
+ * 2) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param bq The destination bit queue
+ * @param groups The groups to write
+ * @param count The number of groups
+ * @return int The number of bits written or -1 in failure
+ */
+static int bit_queue_leb128_put(bit_queue_t *bq, const uint8_t *groups, size_t count);
+
+/**
+ * @brief This function decodes the unsigned LEB128 codes of a contiguous byte aligned region.
+ * The continuation bits of SCAN_GROUPS bytes are gathered at once so the code ends are found with bit scans.
+ * Decoding stops before the first code that isn't whole inside the region or is longer than a window.
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param buffer The region
+ * @param size The size of the region in bytes
+ * @param values Returns the decoded values
+ * @param count The maximal number of codes to decode
+ * @param used Returns the number of bytes decoded
+ * @return size_t The number of codes decoded
+ */
+static size_t bit_queue_uleb128_scan(const uint8_t *buffer, size_t size, uint64_t *values, size_t count, size_t *used);
+
+int bit_queue_write_uleb128(bit_queue_t *bq, uint64_t value)
+{
+    int ret_val = -1;
+    uint8_t groups[LEB128_MAX_GROUPS];
+    size_t count = 0;
+    if (bq == NULL || bq->buffer == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        do
+        {
+            groups[count] = value & VALUE_MASK & BYTE_MASK;
+            value >>= GROUP_VALUE_BITS;
+            groups[count++] |= value ? 1 << GROUP_VALUE_BITS : 0;
+        } while (value);
+        ret_val = bit_queue_leb128_put(bq, groups, count);
+    }
+    return ret_val;
+}
+
+int bit_queue_write_sleb128(bit_queue_t *bq, int64_t value)
+{
+    int ret_val = -1;
+    uint8_t groups[LEB128_MAX_GROUPS];
+    size_t count = 0;
+    bool more = true;
+    if (bq == NULL || bq->buffer == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        while (more)
+        {
+            groups[count] = value & VALUE_MASK & BYTE_MASK;
+            // arithmetic shift, the remaining bits are a sign extension once they are all 0 or all 1
+            value = value < 0 ? ~(~value >> GROUP_VALUE_BITS) : value >> GROUP_VALUE_BITS;
+            more = !((value == 0 && !(groups[count] & 0x40)) || (value == -1 && (groups[count] & 0x40)));
+            groups[count++] |= more ? 1 << GROUP_VALUE_BITS : 0;
+        }
+        ret_val = bit_queue_leb128_put(bq, groups, count);
+    }
+    return ret_val;
+}
+
+int bit_queue_read_uleb128(bit_queue_t *bq, uint64_t *value)
+{
+    int ret_val = -1;
+    if (bq == NULL || bq->buffer == NULL || value == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if ((ret_val = bit_queue_leb128_peek(bq, value, false)) != -1)
+    {
+        bit_queue_advance_read(bq, ret_val);
+        bit_queue_publish_read(bq, ret_val);
+    }
+    return ret_val;
+}
+
+int bit_queue_read_sleb128(bit_queue_t *bq, int64_t *value)
+{
+    int ret_val = -1;
+    if (bq == NULL || bq->buffer == NULL || value == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if ((ret_val = bit_queue_leb128_peek(bq, (uint64_t *)value, true)) != -1)
+    {
+        bit_queue_advance_read(bq, ret_val);
+        bit_queue_publish_read(bq, ret_val);
+    }
+    return ret_val;
+}
+
+int bit_queue_read_uleb128_n(bit_queue_t *bq, uint64_t *values, size_t count)
+{
+    int ret_val = -1;
+    size_t decoded = 0;
+    size_t region;
+    size_t used;
+    size_t n;
+    int bits;
+    if (bq == NULL || bq->buffer == NULL || values == NULL || count == 0)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        while (decoded < count)
+        {
+            n = 0;
+            if (!bq->r_bit_offset)
+            {
+                // the whole bytes of data before the end of the buffer
+                bit_queue_has_data(bq, bq->buffer_size * BITS_IN_BYTE);
+                region = (bq->w_count_cache - BIT_QUEUE_LOAD(&bq->shared->read_count, relaxed)) / BITS_IN_BYTE;
+                region = region < bq->buffer_size - bq->r_byte_offset ? region : bq->buffer_size - bq->r_byte_offset;
+                if ((n = bit_queue_uleb128_scan(bq->buffer + bq->r_byte_offset, region, values + decoded, count - decoded, &used)))
+                {
+                    bit_queue_advance_read(bq, used * BITS_IN_BYTE);
+                    bit_queue_publish_read(bq, used * BITS_IN_BYTE);
+                    decoded += n;
+                }
+            }
+            // unaligned codes, codes crossing the end of the buffer and long codes
+            if (!n && decoded < count)
+            {
+                if ((bits = bit_queue_leb128_peek(bq, values + decoded, false)) == -1)
+                {
+                    // errno is set by bit_queue_leb128_peek
+                    break;
+                }
+                bit_queue_advance_read(bq, bits);
+                bit_queue_publish_read(bq, bits);
+                decoded++;
+            }
+        }
+        ret_val = decoded ? (int)decoded : -1;
+    }
+    return ret_val;
+}
+
+int bit_queue_write_prefix_varint(bit_queue_t *bq, uint64_t value)
+{
+    int ret_val = -1;
+    size_t groups;
+    if (bq == NULL || bq->buffer == NULL)
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        // the number of 7 bit groups the value needs, a group longer than a window marks a raw 64 bit value
+        groups = value ? (WINDOW_BITS - __builtin_clzll(value) + GROUP_VALUE_BITS - 1) / GROUP_VALUE_BITS : 1;
+        // a code longer than the whole buffer would never fit
+        if ((groups <= WINDOW_GROUPS ? groups : WINDOW_GROUPS + 1) * BITS_IN_BYTE > bq->buffer_size * BITS_IN_BYTE)
+        {
+            errno = EMSGSIZE;
+        }
+        else if (!bit_queue_has_space(bq, (groups <= WINDOW_GROUPS ? groups : WINDOW_GROUPS + 1) * BITS_IN_BYTE))
+        {
+            errno = EAGAIN;
+        }
+        else if (groups <= WINDOW_GROUPS)
+        {
+            bit_queue_put_bits(bq, (value << groups) | (1ULL << (groups - 1)), groups * BITS_IN_BYTE);
+            bit_queue_publish_write(bq, groups * BITS_IN_BYTE);
+            ret_val = groups * BITS_IN_BYTE;
+        }
+        else
+        {
+            bit_queue_put_bits(bq, 0, BITS_IN_BYTE);
+            bit_queue_put_bits(bq, value, WINDOW_BITS);
+            bit_queue_publish_write(bq, WINDOW_BITS + BITS_IN_BYTE);
+            ret_val = WINDOW_BITS + BITS_IN_BYTE;
+        }
+    }
+    return ret_val;
+}
+
+int bit_queue_read_prefix_varint(bit_queue_t *bq, uint64_t *value)
+{
+    int ret_val = -1;
+    uint64_t window;
+    size_t avail;
+    size_t groups;
+    if (bq == NULL || bq->buffer == NULL || value == NULL)
+    {
+        errno = EINVAL;
+    }
+    else if ((avail = bit_queue_peek_bits(bq, 0, &window)) < BITS_IN_BYTE)
+    {
+        errno = EAGAIN;
+    }
+    else if (window & BYTE_MASK)
+    {
+        // the length is the position of the first one bit, the value follows it in the same window
+        groups = __builtin_ctzll(window) + 1;
+        if (avail < groups * BITS_IN_BYTE)
+        {
+            errno = EAGAIN;
+        }
+        else
+        {
+            *value = (window & GROUPS_MASK(groups)) >> groups;
+            ret_val = groups * BITS_IN_BYTE;
+        }
+    }
+    else if (bit_queue_peek_bits(bq, BITS_IN_BYTE, &window) < WINDOW_BITS)
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        *value = window;
+        ret_val = WINDOW_BITS + BITS_IN_BYTE;
+    }
+    if (ret_val != -1)
+    {
+        bit_queue_advance_read(bq, ret_val);
+        bit_queue_publish_read(bq, ret_val);
+    }
+    return ret_val;
+}
+
+// static functions
+
+static uint64_t bit_queue_varint_compact(uint64_t window, size_t groups)
+{
+    window &= GROUPS_MASK(groups);
+#ifdef __BMI2__
+    return _pext_u64(window, VALUE_MASK);
+#else
+    // merge the 7 bit groups in pairs, then the 14 bit pairs and then the 28 bit quads
+    window &= VALUE_MASK;
+    window = (window & 0x007f007f007f007fULL) | ((window & 0x7f007f007f007f00ULL) >> 1);
+    window = (window & 0x00003fff00003fffULL) | ((window & 0x3fff00003fff0000ULL) >> 2);
+    window = (window & 0x000000000fffffffULL) | ((window & 0x0fffffff00000000ULL) >> 4);
+    return window;
+#endif
+}
+
+static int bit_queue_leb128_peek(bit_queue_t *bq, uint64_t *value, bool is_signed)
+{
+    int ret_val = -1;
+    uint64_t window;
+    uint64_t ends;
+    size_t avail;
+    size_t groups;
+    avail = bit_queue_peek_bits(bq, 0, &window);
+    // a group whose continuation bit is clear ends the code
+    ends = ~window & CONTINUATION_MASK & GROUPS_MASK(avail / BITS_IN_BYTE);
+    if (ends)
+    {
+        groups = __builtin_ctzll(ends) / BITS_IN_BYTE + 1;
+        *value = bit_queue_varint_compact(window, groups);
+        if (is_signed && (*value >> (groups * GROUP_VALUE_BITS - 1)) & 1)
+        {
+            *value |= ~0ULL << (groups * GROUP_VALUE_BITS);
+        }
+        ret_val = groups * BITS_IN_BYTE;
+    }
+    else if (avail < WINDOW_BITS)
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        // the code is longer than a window, the last groups hold the top 8 bits
+        *value = bit_queue_varint_compact(window, WINDOW_GROUPS);
+        avail = bit_queue_peek_bits(bq, WINDOW_BITS, &window);
+        ends = ~window & CONTINUATION_MASK & GROUPS_MASK(avail / BITS_IN_BYTE) & GROUPS_MASK(LEB128_MAX_GROUPS - WINDOW_GROUPS);
+        if (!ends)
+        {
+            errno = avail < (LEB128_MAX_GROUPS - WINDOW_GROUPS) * BITS_IN_BYTE ? EAGAIN : EBADMSG;
+        }
+        else
+        {
+            groups = __builtin_ctzll(ends) / BITS_IN_BYTE + 1;
+            window = bit_queue_varint_compact(window, groups);
+            if (!is_signed && window >> (WINDOW_BITS - WINDOW_GROUPS * GROUP_VALUE_BITS))
+            {
+                errno = EBADMSG;
+            }
+            else
+            {
+                *value |= window << (WINDOW_GROUPS * GROUP_VALUE_BITS);
+                if (is_signed && groups == 1 && (*value >> (WINDOW_BITS - 2)) & 1)
+                {
+                    *value |= 1ULL << (WINDOW_BITS - 1);
+                }
+                ret_val = (WINDOW_GROUPS + groups) * BITS_IN_BYTE;
+            }
+        }
+    }
+    return ret_val;
+}
+
+static int bit_queue_leb128_put(bit_queue_t *bq, const uint8_t *groups, size_t count)
+{
+    int ret_val = -1;
+    uint64_t word = 0;
+    size_t i;
+    // a code longer than the whole buffer would never fit
+    if (count * BITS_IN_BYTE > bq->buffer_size * BITS_IN_BYTE)
+    {
+        errno = EMSGSIZE;
+    }
+    else if (!bit_queue_has_space(bq, count * BITS_IN_BYTE))
+    {
+        errno = EAGAIN;
+    }
+    else
+    {
+        for (i = 0; i < count && i < WINDOW_GROUPS; i++)
+        {
+            word |= (uint64_t)groups[i] << (i * BITS_IN_BYTE);
+        }
+        bit_queue_put_bits(bq, word, i * BITS_IN_BYTE);
+        for (word = 0; i < count; i++)
+        {
+            word |= (uint64_t)groups[i] << ((i - WINDOW_GROUPS) * BITS_IN_BYTE);
+        }
+        if (count > WINDOW_GROUPS)
+        {
+            bit_queue_put_bits(bq, word, (count - WINDOW_GROUPS) * BITS_IN_BYTE);
+        }
+        bit_queue_publish_write(bq, count * BITS_IN_BYTE);
+        ret_val = count * BITS_IN_BYTE;
+    }
+    return ret_val;
+}
+
+static size_t bit_queue_uleb128_scan(const uint8_t *buffer, size_t size, uint64_t *values, size_t count, size_t *used)
+{
+    size_t decoded = 0;
+    size_t pos = 0;
+    size_t start;
+    size_t end;
+    uint32_t ends;
+    uint64_t window;
+    bool stop = false;
+    while (!stop && decoded < count && pos + SCAN_GROUPS + sizeof(window) <= size)
+    {
+        // a set bit marks a group whose continuation bit is clear
+#ifdef __SSE2__
+        ends = ~_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(buffer + pos))) & 0xffff;
+#else
+        ends = 0;
+        for (start = 0; start < SCAN_GROUPS; start++)
+        {
+            ends |= (uint32_t)!(buffer[pos + start] >> GROUP_VALUE_BITS) << start;
+        }
+#endif
+        start = 0;
+        while (ends && decoded < count)
+        {
+            end = __builtin_ctz(ends);
+            if (end - start >= WINDOW_GROUPS)
+            {
+                // leave the long code to the generic decoder
+                stop = true;
+                break;
+            }
+            memcpy(&window, buffer + pos + start, sizeof(window));
+            values[decoded++] = bit_queue_varint_compact(le64toh(window), end - start + 1);
+            start = end + 1;
+            ends &= ends - 1;
+        }
+        // a code without an end in the scanned groups is longer than a window
+        stop = stop || !start;
+        pos += start;
+    }
+    *used = pos;
+    return decoded;
+}
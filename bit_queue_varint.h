@@ -0,0 +1,150 @@
+/**
+ * @file bit_queue_varint.h
+ * @author amitfr1
+ * @brief Variable length integer codes over the bit queue
+ * @version 0.1
+ * @date 2026-10-16
+ * @defgroup bit_queue_varint
+ * This module reads and writes variable length integers directly on the bit queue buffer.
+ * LEB128 codes are groups of 8 bits holding 7 value bits and a continuation bit (the last bit of the group).
+ * Prefix varints hold the code length in unary in the first bits so a code is decoded with one load and a shift.
+ * The codes don't need to be byte aligned, when the queue is byte aligned they match the byte oriented formats.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "bit_queue.h"
+
+#ifndef BIT_QUEUE_VARINT_H_
+#define BIT_QUEUE_VARINT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief This function writes an unsigned LEB128 code
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL
+ * 2) Sets errno to EMSGSIZE if the code is longer than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param bq The destination bit queue
+ * @param value The value to write
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_uleb128(bit_queue_t *bq, uint64_t value);
+
+/**
+ * @brief This function writes a signed LEB128 code
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL
+ * 2) Sets errno to EMSGSIZE if the code is longer than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param bq The destination bit queue
+ * @param value The value to write
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_sleb128(bit_queue_t *bq, int64_t value);
+
+/**
+ * @brief This function reads an unsigned LEB128 code
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or value = NULL
+ * 2) Sets errno EBADMSG if the code is longer than 10 groups or doesn't fit 64 bits
+ * 3) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param bq The source bit queue
+ * @param value Returns the decoded value
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_uleb128(bit_queue_t *bq, uint64_t *value);
+
+/**
+ * @brief This function reads a signed LEB128 code
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or value = NULL
+ * 2) Sets errno EBADMSG if the code is longer than 10 groups
+ * 3) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param bq The source bit queue
+ * @param value Returns the decoded value
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_sleb128(bit_queue_t *bq, int64_t *value);
+
+/**
+ * @brief This function reads up to count unsigned LEB128 codes.
+ * While the read cursor is byte aligned the codes are located with a SIMD scan of the continuation bits.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or values = NULL or count = 0
+ * 2) Sets errno EBADMSG if the first code is invalid
+ * 3) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param bq The source bit queue
+ * @param values Returns the decoded values
+ * @param count The maximal number of codes to read
+ * 
+ * @return int The number of codes read or -1 in failure
+ */
+int bit_queue_read_uleb128_n(bit_queue_t *bq, uint64_t *values, size_t count);
+
+/**
+ * @brief This function writes a prefix varint.
+ * A value below 2^(7 * n) for n <= 8 takes n groups of 8 bits, n - 1 zero bits and a one bit followed by the value.
+ * Larger values take 9 groups, 8 zero bits followed by the whole 64 bit value.
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL
+ * 2) Sets errno to EMSGSIZE if the code is longer than the entire bit queue buffer
+ * 3) Sets errno to EAGAIN if there isn't enough space in the queue
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param bq The destination bit queue
+ * @param value The value to write
+ * 
+ * @return int The number of bits written or -1 in failure
+ */
+int bit_queue_write_prefix_varint(bit_queue_t *bq, uint64_t value);
+
+/**
+ * @brief This function reads a prefix varint
+ * 
+ * errno options:
+ * 1) Sets errno EINVAL if bq = NULL or bq->buffer = NULL or value = NULL
+ * 2) Sets errno to EAGAIN if the queue doesn't hold a whole code
+ * 
+ * @ingroup bit_queue_varint
+ * 
+ * @param bq The source bit queue
+ * @param value Returns the decoded value
+ * 
+ * @return int The number of bits read or -1 in failure
+ */
+int bit_queue_read_prefix_varint(bit_queue_t *bq, uint64_t *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// BIT_QUEUE_VARINT_H_
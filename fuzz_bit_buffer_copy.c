@@ -0,0 +1,75 @@
+/**
+ * @file fuzz_bit_buffer_copy.c
+ * @author amitfr1
+ * @brief libFuzzer target that checks bit_queue_bit_buffer_copy against the reference model
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The copy kernel is static so the bit queue source is included directly.
+ * The first 8 bytes of the input pick the buffer sizes, the offsets (out of range ones included) and the bit count,
+ * the rest of the input is the content of the buffers. The buffers are allocated at their exact size so the
+ * sanitizers catch any access past them.
+ */
+#include "bit_queue.c"
+#include "bit_queue_reference.h"
+
+#define FUZZ_MAX_BYTES 32
+#define FUZZ_HEADER_BYTES 8
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static void fuzz_fill(uint8_t *buffer, size_t buffer_size, const uint8_t *data, size_t size, size_t skip)
+{
+    size_t i;
+    for (i = 0; i < buffer_size; i++)
+    {
+        buffer[i] = size ? data[(skip + i) % size] : 0;
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    size_t dst_size, src_size, dst_byte_offset, src_byte_offset, bit_count;
+    uint8_t dst_bit_offset, src_bit_offset;
+    uint8_t * src = NULL;
+    uint8_t * dst = NULL;
+    uint8_t * want = NULL;
+    int got_ret, got_errno, want_ret, want_errno;
+    src_size = size < FUZZ_HEADER_BYTES ? 0 : data[0] % (FUZZ_MAX_BYTES + 1);
+    dst_size = size < FUZZ_HEADER_BYTES ? 0 : data[1] % (FUZZ_MAX_BYTES + 1);
+    if (size < FUZZ_HEADER_BYTES)
+    {
+        // not enough input for the parameters
+    }
+    // empty buffers still get a valid pointer
+    else if (!(src = malloc(src_size ? src_size : 1)) || !(dst = malloc(dst_size ? dst_size : 1)) || !(want = malloc(dst_size ? dst_size : 1)))
+    {
+        // the allocation failed
+    }
+    else
+    {
+        src_byte_offset = data[2] % (src_size + 2);
+        dst_byte_offset = data[3] % (dst_size + 2);
+        src_bit_offset = data[4] % (BITS_IN_BYTE + 1);
+        dst_bit_offset = data[5] % (BITS_IN_BYTE + 1);
+        bit_count = (data[6] | data[7] << BITS_IN_BYTE) % ((FUZZ_MAX_BYTES + 2) * BITS_IN_BYTE);
+        fuzz_fill(src, src_size, data + FUZZ_HEADER_BYTES, size - FUZZ_HEADER_BYTES, 0);
+        fuzz_fill(dst, dst_size, data + FUZZ_HEADER_BYTES, size - FUZZ_HEADER_BYTES, src_size);
+        memcpy(want, dst, dst_size);
+        errno = 0;
+        got_ret = bit_queue_bit_buffer_copy(dst, src, dst_byte_offset, dst_bit_offset, dst_size, src_byte_offset, src_bit_offset, src_size, bit_count);
+        got_errno = errno;
+        errno = 0;
+        want_ret = bit_queue_ref_bit_copy(want, src, dst_byte_offset, dst_bit_offset, dst_size, src_byte_offset, src_bit_offset, src_size, bit_count);
+        want_errno = errno;
+        if (got_ret != want_ret || got_errno != want_errno || memcmp(dst, want, dst_size))
+        {
+            fprintf(stderr, "bit_queue_bit_buffer_copy returned %d errno %d, the model returned %d errno %d\n", got_ret, got_errno, want_ret, want_errno);
+            abort();
+        }
+    }
+    free(want);
+    free(dst);
+    free(src);
+    return 0;
+}
@@ -1,26 +1,356 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "bit_queue.h"
+#include "bit_queue_golomb.h"
+#include "bit_queue_varint.h"
+#include "bit_queue_pack.h"
+#include "bit_queue_huffman.h"
+#include "bit_queue_ans.h"
+#include "bit_queue_lz.h"
+#include "bit_queue_latency.h"
+#include "bit_queue_inline.h"
+#include "test_check.h"
+
+#define RICE_VALUES 5000
+#define ANS_SYMBOLS 5000
 
 int main()
 {
     bit_queue_t * bq1, * bq2;
     uint16_t buffer = 0xaaaa;
     uint8_t a = 0xa;
-    uint16_t res;
+    uint16_t res = 0;
+    uint32_t ue;
+    int32_t se;
+    uint64_t uv;
+    int64_t sv;
+    uint32_t packed[3] = {5, 0, 7};
+    uint8_t lengths[4] = {2, 1, 3, 3};
+    uint8_t long_lengths[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 9};
+    bit_queue_huffman_t * huffman;
+    uint32_t counts[3] = {6, 1, 1};
+    uint8_t symbols[4] = {0, 2, 0, 1};
+    bit_queue_ans_t * ans;
+    uint8_t single[100];
+    char text[32] = "abcabcabcabcabcabcabcabc";
+    uint8_t lz[BIT_QUEUE_LZ_BOUND(sizeof(text))];
+    int lz_size;
+    uint8_t long_bits[75], long_res[75];
+    int fds[2];
+    bit_queue_lz_sink_t * sink;
+    bit_queue_lz_source_t * source;
+    bit_queue_stats_t stats;
+    double percentiles[2] = {50, 99};
+    uint64_t latency[2];
+    uint64_t samples;
+    char shm_name[64];
+    static uint32_t rice[RICE_VALUES];
+    static uint8_t ans_symbols[ANS_SYMBOLS];
+    const char * codewords[10] = {"1", "010", "011", "00100", "00101", "00110", "00111", "0001000", "0001001", "0001010"};
+    int32_t se_values[5] = {0, 1, -1, 2, -2};
+    long code;
+    size_t i, j;
     bq1 = bit_queue_init((uint8_t*)&buffer, 2, false);
     bq2 = bit_queue_base_init(2);
     bit_queue_write_bits(bq2, (uint8_t*)&buffer, 2, 16);
     bit_queue_read_bits(bq1, (uint8_t*)&res, 2, 8);
-    printf("m1 = %d\n", res);
+    check("m1", res, 0xaa);
     res = 0;
     buffer = 0;
     bit_queue_write_bits(bq1, (uint8_t*)&a, 1, 8);
     bit_queue_read_bits(bq2, (uint8_t*)&res, 2, 5);
-    printf("m2 = %d\n", res);
+    check("m2", res, 0xa);
     res = 0;
     bit_queue_read_bits(bq2, (uint8_t*)&res, 2, 1);
-    printf("m3 = %d\n", res);
+    check("m3", res, 1);
     bit_queue_destroy(bq1);
     bit_queue_destroy(bq2);
-    return 0;
-}
\ No newline at end of file
+    // a copy of 256 bits or more moves a cursor further than a uint8_t bit offset holds, so one side copies in bytes
+    bq1 = bit_queue_base_init(128);
+    for (i = 0; i < sizeof(long_bits); i++)
+    {
+        long_bits[i] = i * 37 + 1;
+    }
+    // the cursors start at byte 100 so the 600 bit copies cross the end of the buffer with 376 bits after it
+    for (i = 0; i < 100; i++)
+    {
+        bit_queue_write_bits(bq1, &a, 1, 8);
+        bit_queue_read_bits(bq1, &a, 1, 8);
+    }
+    bit_queue_write_bits(bq1, long_bits, sizeof(long_bits), sizeof(long_bits) * 8);
+    a = 0x5a;
+    bit_queue_write_bits(bq1, &a, 1, 8);
+    for (i = 0; i < sizeof(long_res); i++)
+    {
+        bit_queue_read_bits(bq1, &long_res[i], 1, 8);
+    }
+    a = 0;
+    bit_queue_read_bits(bq1, &a, 1, 8);
+    check("long write", memcmp(long_res, long_bits, sizeof(long_bits)), 0);
+    check("long write next", a, 0x5a);
+    for (i = 0; i < 52; i++)
+    {
+        bit_queue_write_bits(bq1, &a, 1, 8);
+        bit_queue_read_bits(bq1, &a, 1, 8);
+    }
+    for (i = 0; i < sizeof(long_bits); i++)
+    {
+        bit_queue_write_bits(bq1, &long_bits[i], 1, 8);
+    }
+    a = 0xa5;
+    bit_queue_write_bits(bq1, &a, 1, 8);
+    memset(long_res, 0, sizeof(long_res));
+    bit_queue_read_bits(bq1, long_res, sizeof(long_res), sizeof(long_res) * 8);
+    a = 0;
+    bit_queue_read_bits(bq1, &a, 1, 8);
+    check("long read", memcmp(long_res, long_bits, sizeof(long_bits)), 0);
+    check("long read next", a, 0xa5);
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(8);
+    check("ue bits", bit_queue_write_ue(bq1, 7), 7);
+    check("se bits", bit_queue_write_se(bq1, -3), 5);
+    bit_queue_read_ue(bq1, &ue);
+    bit_queue_read_se(bq1, &se);
+    check("ue", ue, 7);
+    check("se", se, -3);
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(16);
+    // the codewords of H.264 table 9-2 are written and read a bit at a time, the info bits are MSB first
+    for (i = 0; i < 10; i++)
+    {
+        for (j = 0; codewords[i][j]; j++)
+        {
+            a = codewords[i][j] - '0';
+            bit_queue_write_bits(bq1, &a, 1, 1);
+        }
+    }
+    for (i = 0; i < 10; i++)
+    {
+        bit_queue_read_ue(bq1, &ue);
+        check("ue codeword", ue, i);
+    }
+    for (i = 0; i < 5; i++)
+    {
+        for (j = 0; codewords[i][j]; j++)
+        {
+            a = codewords[i][j] - '0';
+            bit_queue_write_bits(bq1, &a, 1, 1);
+        }
+        bit_queue_read_se(bq1, &se);
+        check("se codeword", se, se_values[i]);
+    }
+    for (i = 0; i < 10; i++)
+    {
+        check("ue code bits", bit_queue_write_ue(bq1, i), strlen(codewords[i]));
+        for (j = 0, code = 0; codewords[i][j]; j++)
+        {
+            bit_queue_read_bits(bq1, &a, 1, 1);
+            code = code << 1 | (a & 1);
+        }
+        check("ue code", code, strtol(codewords[i], NULL, 2));
+    }
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(1);
+    // a 9 bit code never fits a one byte queue
+    check("ue too long", bit_queue_write_ue(bq1, 15) == -1 && errno == EMSGSIZE, 1);
+    // the quotient 4 in unary and the remainder 3 in 2 bits
+    check("rice bits", bit_queue_write_rice(bq1, 19, 2), 7);
+    bit_queue_read_rice(bq1, &ue, 2);
+    check("rice", ue, 19);
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(4);
+    // an escaped code is 64 bits long
+    check("rice too long", bit_queue_write_rice(bq1, 1000, 0) == -1 && errno == EMSGSIZE, 1);
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(sizeof(rice));
+    // more blocks than the parameters kept on the stack
+    for (i = 0; i < RICE_VALUES; i++)
+    {
+        rice[i] = i * 7 % 1000;
+    }
+    check("rice array", bit_queue_write_rice_u32(bq1, rice, RICE_VALUES) > 0, 1);
+    memset(rice, 0, sizeof(rice));
+    bit_queue_read_rice_u32(bq1, rice, RICE_VALUES);
+    for (i = 0; i < RICE_VALUES && rice[i] == i * 7 % 1000; i++)
+    {
+    }
+    check("rice array", i, RICE_VALUES);
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(16);
+    check("uleb bits", bit_queue_write_uleb128(bq1, 300), 16);
+    check("sleb bits", bit_queue_write_sleb128(bq1, -129), 16);
+    check("prefix bits", bit_queue_write_prefix_varint(bq1, 1ULL << 63), 72);
+    bit_queue_read_uleb128(bq1, &uv);
+    bit_queue_read_sleb128(bq1, &sv);
+    check("uleb", uv, 300);
+    check("sleb", sv, -129);
+    bit_queue_read_prefix_varint(bq1, &uv);
+    check("prefix", uv == 1ULL << 63, 1);
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(1);
+    // a two group code never fits a one byte queue
+    check("uleb too long", bit_queue_write_uleb128(bq1, 300) == -1 && errno == EMSGSIZE, 1);
+    check("prefix too long", bit_queue_write_prefix_varint(bq1, 300) == -1 && errno == EMSGSIZE, 1);
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(4);
+    check("pack bits", bit_queue_pack_u32(bq1, packed, 3, 3), 9);
+    memset(packed, 0, sizeof(packed));
+    bit_queue_unpack_u32(bq1, packed, 3, 3);
+    check("unpack", packed[0], 5);
+    check("unpack", packed[1], 0);
+    check("unpack", packed[2], 7);
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(16);
+    packed[0] = 100;
+    packed[1] = 103;
+    packed[2] = 101;
+    // a 38 bit frame header holding 100 and the zigzag coded differences 6 and 3 at 3 bits each
+    check("delta bits", bit_queue_write_delta_u32(bq1, packed, 3), 44);
+    memset(packed, 0, sizeof(packed));
+    bit_queue_read_delta_u32(bq1, packed, 3);
+    check("delta", packed[0], 100);
+    check("delta", packed[1], 103);
+    check("delta", packed[2], 101);
+    huffman = bit_queue_huffman_init(lengths, 4);
+    // the canonical codes are 0 -> 10, 1 -> 0, 2 -> 110 and 3 -> 111
+    check("huffman bits", bit_queue_write_huffman(bq1, huffman, 3), 3);
+    check("huffman bits", bit_queue_write_huffman(bq1, huffman, 1), 1);
+    check("huffman symbols", bit_queue_read_huffman_n(bq1, huffman, packed, 2), 2);
+    check("huffman", packed[0], 3);
+    check("huffman", packed[1], 1);
+    bit_queue_huffman_destroy(huffman);
+    // a 9 bit code never fits a one byte queue
+    bq2 = bit_queue_base_init(1);
+    huffman = bit_queue_huffman_init(long_lengths, 10);
+    check("huffman too long", bit_queue_write_huffman(bq2, huffman, 9) == -1 && errno == EMSGSIZE, 1);
+    bit_queue_huffman_destroy(huffman);
+    bit_queue_destroy(bq2);
+    ans = bit_queue_ans_init(counts, 3);
+    // four symbols don't push a state past renormalization so only the two final states are coded
+    check("ans bits", bit_queue_write_ans(bq1, ans, symbols, 4, 2), 64);
+    memset(symbols, 0xff, sizeof(symbols));
+    bit_queue_read_ans(bq1, ans, symbols, 4, 2);
+    check("ans", symbols[0], 0);
+    check("ans", symbols[1], 2);
+    check("ans", symbols[2], 0);
+    check("ans", symbols[3], 1);
+    bit_queue_ans_destroy(ans);
+    // a symbol with the whole scale never renormalizes, the coded array is only the final states
+    counts[0] = 0;
+    counts[2] = 0;
+    ans = bit_queue_ans_init(counts, 3);
+    memset(single, 1, sizeof(single));
+    check("ans single bits", bit_queue_write_ans(bq1, ans, single, sizeof(single), 2), 64);
+    memset(single, 0, sizeof(single));
+    bit_queue_read_ans(bq1, ans, single, sizeof(single), 2);
+    check("ans single", memchr(single, 0, sizeof(single)) == NULL, 1);
+    bit_queue_ans_destroy(ans);
+    bit_queue_destroy(bq1);
+    // more symbols than the coded words kept on the stack
+    counts[0] = 6;
+    counts[2] = 1;
+    ans = bit_queue_ans_init(counts, 3);
+    bq1 = bit_queue_base_init(2 * ANS_SYMBOLS);
+    for (i = 0; i < ANS_SYMBOLS; i++)
+    {
+        ans_symbols[i] = i % 8 < 6 ? 0 : i % 8 - 5;
+    }
+    check("ans array", bit_queue_write_ans(bq1, ans, ans_symbols, ANS_SYMBOLS, 4) > 0, 1);
+    memset(ans_symbols, 0xff, sizeof(ans_symbols));
+    bit_queue_read_ans(bq1, ans, ans_symbols, ANS_SYMBOLS, 4);
+    for (i = 0; i < ANS_SYMBOLS && ans_symbols[i] == (i % 8 < 6 ? 0 : i % 8 - 5); i++)
+    {
+    }
+    check("ans array", i, ANS_SYMBOLS);
+    bit_queue_ans_destroy(ans);
+    bit_queue_destroy(bq1);
+    lz_size = bit_queue_lz_compress((uint8_t*)text, sizeof(text), lz, sizeof(lz));
+    memset(text, 0, sizeof(text));
+    bit_queue_lz_decompress(lz, lz_size, (uint8_t*)text, sizeof(text));
+    check("lz size", lz_size, 16);
+    check("lz", strcmp(text, "abcabcabcabcabcabcabcabc"), 0);
+    // a frame drained from a small queue is filled into a small queue once its block fits
+    bq1 = bit_queue_base_init(sizeof(text));
+    bq2 = bit_queue_base_init(sizeof(text));
+    bit_queue_write_bits(bq1, (uint8_t*)text, sizeof(text), sizeof(text) * 8);
+    bit_queue_write_bits(bq2, (uint8_t*)text, sizeof(text), 8);
+    pipe(fds);
+    sink = bit_queue_lz_sink_init(fds[1]);
+    source = bit_queue_lz_source_init(fds[0]);
+    check("lz drain", bit_queue_lz_drain(bq1, sink), sizeof(text));
+    check("lz fill full", bit_queue_lz_fill(bq2, source) == -1 && errno == EAGAIN, 1);
+    bit_queue_read_bits(bq2, (uint8_t*)&res, 2, 8);
+    memset(text, 0, sizeof(text));
+    check("lz fill", bit_queue_lz_fill(bq2, source), sizeof(text));
+    bit_queue_read_bits(bq2, (uint8_t*)text, sizeof(text), sizeof(text) * 8);
+    check("lz fill", strcmp(text, "abcabcabcabcabcabcabcabc"), 0);
+    bit_queue_destroy(bq2);
+    bq2 = bit_queue_base_init(sizeof(text) / 2);
+    bit_queue_write_bits(bq1, (uint8_t*)text, sizeof(text), sizeof(text) * 8);
+    bit_queue_lz_drain(bq1, sink);
+    check("lz fill too large", bit_queue_lz_fill(bq2, source) == -1 && errno == EMSGSIZE, 1);
+    // the header is kept by the source so the frame can still be filled into another queue
+    memset(text, 0, sizeof(text));
+    check("lz fill kept", bit_queue_lz_fill(bq1, source), sizeof(text));
+    bit_queue_read_bits(bq1, (uint8_t*)text, sizeof(text), sizeof(text) * 8);
+    check("lz fill kept", strcmp(text, "abcabcabcabcabcabcabcabc"), 0);
+    // the stream ends once the write end is closed
+    close(fds[1]);
+    check("lz end", bit_queue_lz_fill(bq1, source), 0);
+    bit_queue_lz_sink_destroy(sink);
+    bit_queue_lz_source_destroy(source);
+    close(fds[0]);
+    bit_queue_destroy(bq1);
+    bit_queue_destroy(bq2);
+    bq1 = bit_queue_base_init(2);
+    bit_queue_write_bits(bq1, (uint8_t*)&buffer, 2, 12);
+    bit_queue_write_bits(bq1, (uint8_t*)&buffer, 2, 12);
+    bit_queue_read_bits(bq1, (uint8_t*)&res, 2, 12);
+#ifdef BIT_QUEUE_STATS
+    // the second write doesn't fit
+    check("stats", bit_queue_get_stats(bq1, &stats), 0);
+    check("stats written", stats.bits_written, 12);
+    check("stats read", stats.bits_read, 12);
+    check("stats write eagain", stats.write_eagain, 1);
+    check("stats high water", stats.high_water_bits, 12);
+#else
+    check("stats not supported", bit_queue_get_stats(bq1, &stats) == -1 && errno == ENOTSUP, 1);
+#endif
+#ifdef BIT_QUEUE_LATENCY
+    // only the write that fit is timed, the bits it published were read once
+    check("latency", bit_queue_get_latency(bq1, BIT_QUEUE_LATENCY_WRITE, percentiles, 2, latency, &samples), 0);
+    check("latency write samples", samples, 1);
+    check("latency write p50 <= p99", latency[0] <= latency[1], 1);
+    check("latency", bit_queue_get_latency(bq1, BIT_QUEUE_LATENCY_RESIDENCE, percentiles, 2, latency, &samples), 0);
+    check("latency residence samples", samples, 1);
+#else
+    check("latency not supported", bit_queue_get_latency(bq1, BIT_QUEUE_LATENCY_WRITE, percentiles, 2, latency, &samples) == -1 && errno == ENOTSUP, 1);
+#endif
+    bit_queue_destroy(bq1);
+    // the residence stamps are kept by the handle so a shared memory queue has none
+    snprintf(shm_name, sizeof(shm_name), "/bit_queue_test_%d", (int)getpid());
+    bq1 = bit_queue_shm_create(shm_name, 8);
+    shm_unlink(shm_name);
+    check("latency shm residence", bit_queue_get_latency(bq1, BIT_QUEUE_LATENCY_RESIDENCE, percentiles, 2, latency, &samples) == -1 && errno == ENOTSUP, 1);
+    bit_queue_destroy(bq1);
+    bq1 = bit_queue_base_init(64);
+    bit_queue_write_value(bq1, 0x1234, 13);
+    bit_queue_write_value(bq1, 0xabcdef, 24);
+    bit_queue_read_value(bq1, &ue, 13);
+    check("inline", ue, 0x1234);
+    bit_queue_read_value(bq1, &ue, 24);
+    check("inline", ue, 0xabcdef);
+    // 64 bits at an unaligned cursor spill into the byte after the word
+    bit_queue_write_value(bq1, 5, 3);
+    bit_queue_write_value64(bq1, 0x0123456789abcdefULL, 64);
+    bit_queue_read_value(bq1, &ue, 3);
+    check("inline", ue, 5);
+    bit_queue_read_value64(bq1, &uv, 64);
+    check("inline 64", uv == 0x0123456789abcdefULL, 1);
+    bit_queue_destroy(bq1);
+    return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include <cerrno>
+#include <system_error>
+#include "bit_queue.hpp"
+#include "bit_queue_schema.hpp"
+#include "test_check.h"
+
+enum class kind : uint8_t
+{
+    data = 1,
+    ack = 5
+};
+
+struct header
+{
+    uint8_t version;
+    bool urgent;
+    int16_t delta;
+    using schema = bit_queue::schema<bit_queue::field<&header::version, 3>, bit_queue::field<&header::urgent, 1>,
+                                     bit_queue::field<&header::delta, 12>>;
+};
+
+struct record
+{
+    kind type;
+    uint64_t id;
+    int32_t offset;
+    uint32_t length;
+    using schema = bit_queue::schema<bit_queue::field<&record::type, 3>, bit_queue::field<&record::id, 60>,
+                                     bit_queue::field<&record::offset, 20>, bit_queue::field<&record::length, 17>>;
+};
+
+// the layout is a constant expression, the first field in the low bits
+static_assert(header::schema::encode(header{5, true, -100})[0] == (5 | 1 << 3 | (-100 & 0xfff) << 4));
+static_assert(record::schema::words == 2);
+
+int main()
+{
+    bit_queue::queue q(16);
+    bit_queue::queue moved(nullptr);
+    std::optional<uint16_t> small;
+    std::optional<uint64_t> large;
+    q.write<13>(0x1234);
+    q.write<40>(0xabcdef0123ULL);
+    moved = std::move(q);
+    small = moved.read<13>();
+    large = moved.read<40>();
+    check("cpp moved from", static_cast<bool>(q), 0);
+    check("cpp read 13", small.value_or(0), 0x1234);
+    check("cpp read 40", large.value_or(0), 0xabcdef0123LL);
+    check("cpp read empty", moved.read<1>().has_value(), 0);
+    // the 128 bit queue is empty again so it takes two 64 bit writes
+    check("cpp write 64", moved.write<64>(~0ULL), 1);
+    check("cpp write 64", moved.write<64>(~0ULL), 1);
+    check("cpp write full", moved.write<64>(~0ULL), 0);
+    try
+    {
+        bit_queue::queue empty(std::size_t(0));
+        check("cpp throws", 0, 1);
+    }
+    catch (const std::system_error &error)
+    {
+        check("cpp throws", error.code().value(), EINVAL);
+    }
+    header h = {5, true, -100};
+    record r = {kind::ack, 0xfedcba987654321ULL, -70000, 99999};
+    bit_queue::queue messages(64);
+    check("schema write header", header::schema::write(messages, h), 1);
+    check("schema write record", record::schema::write(messages, r), 1);
+    h = header{};
+    r = record{};
+    check("schema read header", header::schema::read(messages, h), 1);
+    check("schema read record", record::schema::read(messages, r), 1);
+    check("schema header bits", header::schema::bits, 16);
+    check("schema version", h.version, 5);
+    check("schema urgent", h.urgent, 1);
+    check("schema delta", h.delta, -100);
+    check("schema read empty", header::schema::read(messages, h), 0);
+    check("schema record bits", record::schema::bits, 100);
+    check("schema type", static_cast<int>(r.type), static_cast<int>(kind::ack));
+    check("schema id", r.id, 0xfedcba987654321LL);
+    // the 20 bit field holds a negative offset that is sign extended when read
+    check("schema offset", r.offset, -70000);
+    check("schema length", r.length, 99999);
+    return failures ? 1 : 0;
+}
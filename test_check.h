@@ -0,0 +1,42 @@
+/**
+ * @file test_check.h
+ * @author amitfr1
+ * @brief The result check shared by the tests
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Each test includes it once and returns failures ? 1 : 0 from main, it compiles as C and as C++.
+ */
+#include <stdio.h>
+
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The number of results that didn't match their expected value
+ */
+static int failures = 0;
+
+/**
+ * @brief This function prints a result and counts a failure if it isn't the expected value
+ */
+static inline void check(const char *name, long long got, long long want)
+{
+    printf("%s = %lld", name, got);
+    if (got != want)
+    {
+        printf(" expected %lld", want);
+        failures++;
+    }
+    printf("\n");
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /// TEST_CHECK_H_
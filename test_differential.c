@@ -0,0 +1,748 @@
+/**
+ * @file test_differential.c
+ * @author amitfr1
+ * @brief Differential test of the bit queue against the bit by bit reference model
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The first pass writes and reads every bit count from every start bit of small queues, so every write and read
+ * bit offset and every wrap point is crossed. The second pass runs random sequences of reads, writes, multi writes,
+ * transfers and the inline reads and writes on pairs of queues, with bit counts that are also invalid or too large for
+ * the queue, and compares every return value, errno and buffer with the model.
+ * The third pass round trips random values through every codec, the queues are filled before they are drained so the
+ * codes cross the end of the buffer at every bit.
+ * Usage: test_differential [seed (default 1)] [random sequences (default 2000)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "bit_queue.h"
+#include "bit_queue_inline.h"
+#include "bit_queue_golomb.h"
+#include "bit_queue_varint.h"
+#include "bit_queue_pack.h"
+#include "bit_queue_huffman.h"
+#include "bit_queue_ans.h"
+#include "bit_queue_lz.h"
+#include "bit_queue_reference.h"
+
+#define EXHAUSTIVE_MAX_BYTES 8
+#define RANDOM_OPS 200
+#define RANDOM_MAX_BYTES 600
+#define BUFFER_BYTES (RANDOM_MAX_BYTES + 2)
+#define CODEC_ROUNDS 200
+#define CODEC_VALUES 300
+#define CODEC_SYMBOLS 512
+#define CODEC_LZ_BYTES 4096
+
+static uint64_t rng_state;
+
+static uint64_t rng(void)
+{
+    // xorshift64*, the sequences don't depend on the libc
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+static void rng_fill(uint8_t *buffer, size_t size)
+{
+    size_t i;
+    for (i = 0; i < size; i++)
+    {
+        buffer[i] = rng();
+    }
+}
+
+static int compare(const char *op, size_t bit_count, int got, int got_errno, const uint8_t *got_buffer, int want, int want_errno, const uint8_t *want_buffer, size_t buffer_size)
+{
+    int ret_val = 0;
+    if (got != want || (want == -1 && got_errno != want_errno))
+    {
+        printf("%s bit_count=%zu returned %d errno %d, the model returned %d errno %d\n", op, bit_count, got, got_errno, want, want_errno);
+        ret_val = -1;
+    }
+    else if (got_buffer != NULL && memcmp(got_buffer, want_buffer, buffer_size))
+    {
+        printf("%s bit_count=%zu buffer differs from the model\n", op, bit_count);
+        ret_val = -1;
+    }
+    return ret_val;
+}
+
+static int exhaustive(void)
+{
+    static uint8_t src[EXHAUSTIVE_MAX_BYTES], got[EXHAUSTIVE_MAX_BYTES], want[EXHAUSTIVE_MAX_BYTES];
+    bit_queue_t * bq;
+    bit_queue_ref_t ref;
+    size_t byte_count, start, bit_count;
+    int ret_val = 0;
+    int got_ret, want_ret;
+    for (byte_count = 1; byte_count <= EXHAUSTIVE_MAX_BYTES && !ret_val; byte_count++)
+    {
+        for (start = 0; start < byte_count * 8 && !ret_val; start++)
+        {
+            for (bit_count = 1; bit_count <= byte_count * 8 && !ret_val; bit_count++)
+            {
+                bq = bit_queue_base_init(byte_count);
+                bit_queue_ref_init(&ref, byte_count);
+                if (start)
+                {
+                    // move both cursors to the start bit
+                    bit_queue_write_bits(bq, src, sizeof(src), start);
+                    bit_queue_read_bits(bq, got, sizeof(got), start);
+                    bit_queue_ref_write_bits(&ref, src, sizeof(src), start);
+                    bit_queue_ref_read_bits(&ref, want, sizeof(want), start);
+                }
+                rng_fill(src, sizeof(src));
+                rng_fill(got, sizeof(got));
+                memcpy(want, got, sizeof(want));
+                got_ret = bit_queue_write_bits(bq, src, sizeof(src), bit_count);
+                want_ret = bit_queue_ref_write_bits(&ref, src, sizeof(src), bit_count);
+                ret_val = compare("write", bit_count, got_ret, 0, NULL, want_ret, 0, NULL, 0);
+                if (!ret_val)
+                {
+                    got_ret = bit_queue_read_bits(bq, got, sizeof(got), bit_count);
+                    want_ret = bit_queue_ref_read_bits(&ref, want, sizeof(want), bit_count);
+                    ret_val = compare("read", bit_count, got_ret, 0, got, want_ret, 0, want, sizeof(want));
+                }
+                if (ret_val)
+                {
+                    printf("exhaustive byte_count=%zu start=%zu\n", byte_count, start);
+                }
+                bit_queue_ref_destroy(&ref);
+                bit_queue_destroy(bq);
+            }
+        }
+    }
+    return ret_val;
+}
+
+static size_t random_bit_count(size_t capacity)
+{
+    size_t ret_val;
+    switch (rng() % 8)
+    {
+    case 0:
+        // invalid or larger than the queue
+        ret_val = rng() % 2 ? 0 : capacity + 1 + rng() % 16;
+        break;
+    case 1:
+    case 2:
+    case 3:
+        ret_val = 1 + rng() % 16;
+        break;
+    default:
+        ret_val = 1 + rng() % capacity;
+        break;
+    }
+    return ret_val;
+}
+
+static int sequence(void)
+{
+    static uint8_t src[BUFFER_BYTES], got[BUFFER_BYTES], want[BUFFER_BYTES];
+    bit_queue_t * queues[2];
+    bit_queue_ref_t refs[2];
+    bit_queue_ref_t * ref_ptrs[2] = {&refs[0], &refs[1]};
+    size_t byte_counts[2];
+    size_t i, q, bit_count, buffer_size;
+    uint8_t * initial;
+    int ret_val = 0;
+    int got_ret, got_errno, want_ret;
+    for (q = 0; q < 2; q++)
+    {
+        byte_counts[q] = 1 + rng() % (rng() % 4 ? 40 : RANDOM_MAX_BYTES);
+        if (rng() % 4)
+        {
+            queues[q] = bit_queue_base_init(byte_counts[q]);
+            bit_queue_ref_init(&refs[q], byte_counts[q]);
+        }
+        else
+        {
+            // a queue that starts full of the given buffer
+            initial = malloc(byte_counts[q]);
+            rng_fill(initial, byte_counts[q]);
+            bit_queue_ref_init_full(&refs[q], initial, byte_counts[q]);
+            queues[q] = bit_queue_init(initial, byte_counts[q], true);
+        }
+    }
+    for (i = 0; i < RANDOM_OPS && !ret_val; i++)
+    {
+        q = rng() % 2;
+        bit_count = random_bit_count(byte_counts[q] * 8);
+        // sometimes the buffer is too small for the bit count
+        buffer_size = rng() % 16 ? (bit_count + 7) / 8 : bit_count / 8;
+        buffer_size = buffer_size < BUFFER_BYTES ? buffer_size : BUFFER_BYTES;
+        rng_fill(src, sizeof(src));
+        rng_fill(got, sizeof(got));
+        memcpy(want, got, sizeof(want));
+        switch (rng() % 6)
+        {
+        case 0:
+            got_ret = bit_queue_write_bits(queues[q], src, buffer_size, bit_count);
+            got_errno = errno;
+            want_ret = bit_queue_ref_write_bits(&refs[q], src, buffer_size, bit_count);
+            ret_val = compare("write_bits", bit_count, got_ret, got_errno, NULL, want_ret, errno, NULL, 0);
+            break;
+        case 1:
+            got_ret = bit_queue_read_bits(queues[q], got, buffer_size, bit_count);
+            got_errno = errno;
+            want_ret = bit_queue_ref_read_bits(&refs[q], want, buffer_size, bit_count);
+            ret_val = compare("read_bits", bit_count, got_ret, got_errno, got, want_ret, errno, want, sizeof(want));
+            break;
+        case 2:
+            got_ret = bit_queue_write_bits_multi(queues, 2, src, buffer_size, bit_count);
+            got_errno = errno;
+            want_ret = bit_queue_ref_write_bits_multi(ref_ptrs, 2, src, buffer_size, bit_count);
+            ret_val = compare("write_bits_multi", bit_count, got_ret, got_errno, NULL, want_ret, errno, NULL, 0);
+            break;
+        case 3:
+            got_ret = bit_queue_write_bits_inline(queues[q], src, buffer_size, bit_count);
+            got_errno = errno;
+            want_ret = bit_queue_ref_write_bits(&refs[q], src, buffer_size, bit_count);
+            ret_val = compare("write_bits_inline", bit_count, got_ret, got_errno, NULL, want_ret, errno, NULL, 0);
+            break;
+        case 4:
+            got_ret = bit_queue_read_bits_inline(queues[q], got, buffer_size, bit_count);
+            got_errno = errno;
+            want_ret = bit_queue_ref_read_bits(&refs[q], want, buffer_size, bit_count);
+            ret_val = compare("read_bits_inline", bit_count, got_ret, got_errno, got, want_ret, errno, want, sizeof(want));
+            break;
+        default:
+            got_ret = bit_queue_transfer(queues[!q], queues[q], bit_count);
+            got_errno = errno;
+            want_ret = bit_queue_ref_transfer(&refs[!q], &refs[q], bit_count);
+            ret_val = compare("transfer", bit_count, got_ret, got_errno, NULL, want_ret, errno, NULL, 0);
+            break;
+        }
+        if (ret_val)
+        {
+            printf("sequence op=%zu queue=%zu byte_counts=%zu,%zu\n", i, q, byte_counts[0], byte_counts[1]);
+        }
+    }
+    for (q = 0; q < 2; q++)
+    {
+        // drain what is left so the whole content of the queues is compared
+        while (!ret_val && refs[q].count > 0)
+        {
+            bit_count = refs[q].count < 64 ? refs[q].count : 64;
+            got_ret = bit_queue_read_bits(queues[q], got, sizeof(got), bit_count);
+            want_ret = bit_queue_ref_read_bits(&refs[q], want, sizeof(want), bit_count);
+            ret_val = compare("drain", bit_count, got_ret, 0, got, want_ret, 0, want, sizeof(want));
+        }
+        bit_queue_ref_destroy(&refs[q]);
+        bit_queue_destroy(queues[q]);
+    }
+    return ret_val;
+}
+
+static uint32_t random_value(uint32_t max)
+{
+    // every magnitude is as likely as the others
+    uint32_t ret_val = (uint32_t)rng() >> (rng() % 32);
+    return ret_val <= max ? ret_val : max;
+}
+
+static uint64_t random_value64(void)
+{
+    return rng() >> (rng() % 64);
+}
+
+static int32_t signed_value(uint32_t value)
+{
+    return value & 1 ? -(int32_t)(value >> 1) : (int32_t)(value >> 1);
+}
+
+static bit_queue_t *codec_queue(size_t min_bytes)
+{
+    uint8_t bits[8];
+    bit_queue_t * bq = bit_queue_base_init(min_bytes + rng() % 64);
+    // the codes start at a random bit of the buffer
+    size_t skew = rng() % 64;
+    if (skew)
+    {
+        bit_queue_write_bits(bq, bits, sizeof(bits), skew);
+        bit_queue_read_bits(bq, bits, sizeof(bits), skew);
+    }
+    return bq;
+}
+
+static size_t chunk_length(size_t written)
+{
+    // mostly short arrays, sometimes long enough to cross the blocks and frames of the array codecs
+    size_t ret_val = 1 + rng() % (rng() % 4 ? 8 : CODEC_VALUES);
+    return ret_val < CODEC_VALUES - written ? ret_val : CODEC_VALUES - written;
+}
+
+static int codec_mismatch(const char *codec, size_t index, int ret, unsigned long long got, unsigned long long want)
+{
+    printf("%s value=%zu returned %d errno %d, got %llu expected %llu\n", codec, index, ret, errno, got, want);
+    return -1;
+}
+
+static int codec_golomb(void)
+{
+    bit_queue_t * bq = codec_queue(8);
+    uint32_t values[CODEC_VALUES];
+    uint32_t ue = 0;
+    int32_t se = 0;
+    size_t i, written = 0, read = 0;
+    int ret_val = 0;
+    int ret;
+    for (i = 0; i < CODEC_VALUES; i++)
+    {
+        values[i] = random_value(BIT_QUEUE_UE_MAX);
+    }
+    // the even values are coded as ue(v) and the odd ones as se(v)
+    while (!ret_val && read < CODEC_VALUES)
+    {
+        while (written < CODEC_VALUES &&
+               (written % 2 ? bit_queue_write_se(bq, signed_value(values[written])) : bit_queue_write_ue(bq, values[written])) != -1)
+        {
+            written++;
+        }
+        if (written < CODEC_VALUES && errno != EAGAIN)
+        {
+            ret_val = codec_mismatch("write_golomb", written, -1, 0, 0);
+        }
+        for (; !ret_val && read < written; read++)
+        {
+            if (read % 2 && ((ret = bit_queue_read_se(bq, &se)) == -1 || se != signed_value(values[read])))
+            {
+                ret_val = codec_mismatch("read_se", read, ret, se, signed_value(values[read]));
+            }
+            else if (!(read % 2) && ((ret = bit_queue_read_ue(bq, &ue)) == -1 || ue != values[read]))
+            {
+                ret_val = codec_mismatch("read_ue", read, ret, ue, values[read]);
+            }
+        }
+    }
+    bit_queue_destroy(bq);
+    return ret_val;
+}
+
+static int codec_varint(void)
+{
+    bit_queue_t * bq = codec_queue(10);
+    uint64_t values[CODEC_VALUES];
+    uint64_t uv = 0;
+    int64_t sv = 0;
+    size_t i, written = 0, read = 0;
+    int ret_val = 0;
+    int ret;
+    for (i = 0; i < CODEC_VALUES; i++)
+    {
+        values[i] = random_value64();
+    }
+    // the values take turns as unsigned and signed LEB128 and as prefix varints
+    while (!ret_val && read < CODEC_VALUES)
+    {
+        while (written < CODEC_VALUES &&
+               (written % 3 == 0 ? bit_queue_write_uleb128(bq, values[written]) :
+                written % 3 == 1 ? bit_queue_write_sleb128(bq, (int64_t)values[written]) :
+                bit_queue_write_prefix_varint(bq, values[written])) != -1)
+        {
+            written++;
+        }
+        if (written < CODEC_VALUES && errno != EAGAIN)
+        {
+            ret_val = codec_mismatch("write_varint", written, -1, 0, 0);
+        }
+        for (; !ret_val && read < written; read++)
+        {
+            if (read % 3 == 0 && ((ret = bit_queue_read_uleb128(bq, &uv)) == -1 || uv != values[read]))
+            {
+                ret_val = codec_mismatch("read_uleb128", read, ret, uv, values[read]);
+            }
+            else if (read % 3 == 1 && ((ret = bit_queue_read_sleb128(bq, &sv)) == -1 || (uint64_t)sv != values[read]))
+            {
+                ret_val = codec_mismatch("read_sleb128", read, ret, sv, values[read]);
+            }
+            else if (read % 3 == 2 && ((ret = bit_queue_read_prefix_varint(bq, &uv)) == -1 || uv != values[read]))
+            {
+                ret_val = codec_mismatch("read_prefix_varint", read, ret, uv, values[read]);
+            }
+        }
+    }
+    bit_queue_destroy(bq);
+    return ret_val;
+}
+
+static int codec_pack(void)
+{
+    bit_queue_t * bq = codec_queue(CODEC_VALUES * sizeof(uint32_t));
+    uint32_t values[CODEC_VALUES];
+    uint32_t got[CODEC_VALUES] = {0};
+    size_t lengths[CODEC_VALUES];
+    uint8_t widths[CODEC_VALUES];
+    size_t i, written = 0, read = 0;
+    int ret_val = 0;
+    int ret;
+    while (!ret_val && read < CODEC_VALUES)
+    {
+        // the arrays are written in chunks of random length and width
+        while (written < CODEC_VALUES)
+        {
+            lengths[written] = chunk_length(written);
+            widths[written] = 1 + rng() % BIT_QUEUE_PACK_MAX_WIDTH;
+            for (i = written; i < written + lengths[written]; i++)
+            {
+                values[i] = random_value(UINT32_MAX >> (32 - widths[written]));
+            }
+            if (bit_queue_pack_u32(bq, values + written, lengths[written], widths[written]) == -1)
+            {
+                break;
+            }
+            written += lengths[written];
+        }
+        if (written < CODEC_VALUES && errno != EAGAIN)
+        {
+            ret_val = codec_mismatch("pack_u32", written, -1, 0, 0);
+        }
+        for (; !ret_val && read < written; read += lengths[read])
+        {
+            if ((ret = bit_queue_unpack_u32(bq, got, lengths[read], widths[read])) == -1 ||
+                memcmp(got, values + read, lengths[read] * sizeof(uint32_t)))
+            {
+                for (i = 0; ret != -1 && got[i] == values[read + i]; i++)
+                {
+                }
+                ret_val = codec_mismatch("unpack_u32", read + i, ret, got[i], values[read + i]);
+            }
+        }
+    }
+    bit_queue_destroy(bq);
+    return ret_val;
+}
+
+static int codec_frames(void)
+{
+    bit_queue_t * bq = codec_queue(CODEC_VALUES * sizeof(uint32_t) + 16);
+    uint32_t values[CODEC_VALUES];
+    uint32_t got[CODEC_VALUES] = {0};
+    size_t lengths[CODEC_VALUES];
+    bool delta[CODEC_VALUES];
+    size_t i, written = 0, read = 0;
+    int ret_val = 0;
+    int ret;
+    for (i = 0; i < CODEC_VALUES; i++)
+    {
+        // runs of increasing values, the case delta coding is for, broken by random jumps
+        values[i] = i && rng() % 16 ? values[i - 1] + random_value(1000) : random_value(UINT32_MAX);
+    }
+    while (!ret_val && read < CODEC_VALUES)
+    {
+        // the chunks are coded as FOR or as delta frames
+        while (written < CODEC_VALUES)
+        {
+            lengths[written] = chunk_length(written);
+            delta[written] = rng() % 2;
+            if ((delta[written] ? bit_queue_write_delta_u32(bq, values + written, lengths[written]) :
+                 bit_queue_write_for_u32(bq, values + written, lengths[written])) == -1)
+            {
+                break;
+            }
+            written += lengths[written];
+        }
+        if (written < CODEC_VALUES && errno != EAGAIN)
+        {
+            ret_val = codec_mismatch(delta[written] ? "write_delta_u32" : "write_for_u32", written, -1, 0, 0);
+        }
+        for (; !ret_val && read < written; read += lengths[read])
+        {
+            if ((ret = delta[read] ? bit_queue_read_delta_u32(bq, got, lengths[read]) : bit_queue_read_for_u32(bq, got, lengths[read])) == -1 ||
+                memcmp(got, values + read, lengths[read] * sizeof(uint32_t)))
+            {
+                for (i = 0; ret != -1 && got[i] == values[read + i]; i++)
+                {
+                }
+                ret_val = codec_mismatch(delta[read] ? "read_delta_u32" : "read_for_u32", read + i, ret, got[i], values[read + i]);
+            }
+        }
+    }
+    bit_queue_destroy(bq);
+    return ret_val;
+}
+
+static int codec_huffman(void)
+{
+    bit_queue_t * bq = codec_queue(BIT_QUEUE_HUFFMAN_MAX_LENGTH / 8);
+    bit_queue_huffman_t * huffman;
+    uint8_t lengths[CODEC_SYMBOLS];
+    uint32_t values[CODEC_VALUES];
+    uint32_t got[CODEC_VALUES] = {0};
+    size_t symbol_count = 1 + rng() % CODEC_SYMBOLS;
+    size_t kraft = 0;
+    size_t i, n, written = 0, read = 0;
+    int ret_val = 0;
+    int ret;
+    // random lengths that keep the Kraft sum (in units of 2^-16) at most 1, a length that doesn't fit is made longer
+    for (i = 0; i < symbol_count; i++)
+    {
+        for (lengths[i] = rng() % 4 ? 1 + rng() % BIT_QUEUE_HUFFMAN_MAX_LENGTH : 0;
+             lengths[i] && kraft + (1 << (BIT_QUEUE_HUFFMAN_MAX_LENGTH - lengths[i])) > 1 << BIT_QUEUE_HUFFMAN_MAX_LENGTH;
+             lengths[i] = lengths[i] < BIT_QUEUE_HUFFMAN_MAX_LENGTH ? lengths[i] + 1 : 0)
+        {
+        }
+        kraft += lengths[i] ? 1 << (BIT_QUEUE_HUFFMAN_MAX_LENGTH - lengths[i]) : 0;
+    }
+    if (!kraft)
+    {
+        lengths[0] = 1;
+    }
+    huffman = bit_queue_huffman_init(lengths, symbol_count);
+    for (i = 0; i < CODEC_VALUES; i++)
+    {
+        for (values[i] = rng() % symbol_count; !lengths[values[i]]; values[i] = (values[i] + 1) % symbol_count)
+        {
+        }
+    }
+    while (!ret_val && read < CODEC_VALUES)
+    {
+        while (written < CODEC_VALUES && bit_queue_write_huffman(bq, huffman, values[written]) != -1)
+        {
+            written++;
+        }
+        if (written < CODEC_VALUES && errno != EAGAIN)
+        {
+            ret_val = codec_mismatch("write_huffman", written, -1, 0, 0);
+        }
+        // the symbols are read one at a time or in runs of random length
+        for (; !ret_val && read < written; read += n)
+        {
+            n = rng() % 2 ? 1 + rng() % (written - read) : 1;
+            ret = n == 1 ? bit_queue_read_huffman(bq, huffman, got) : bit_queue_read_huffman_n(bq, huffman, got, n);
+            if (ret == -1 || (n > 1 && (size_t)ret != n) || memcmp(got, values + read, n * sizeof(uint32_t)))
+            {
+                for (i = 0; ret != -1 && i < n - 1 && got[i] == values[read + i]; i++)
+                {
+                }
+                ret_val = codec_mismatch(n == 1 ? "read_huffman" : "read_huffman_n", read + i, ret, got[i], values[read + i]);
+            }
+        }
+    }
+    bit_queue_huffman_destroy(huffman);
+    bit_queue_destroy(bq);
+    return ret_val;
+}
+
+static int codec_ans(void)
+{
+    bit_queue_t * bq = codec_queue((CODEC_VALUES + 2 * BIT_QUEUE_ANS_MAX_STREAMS) * sizeof(uint16_t));
+    bit_queue_ans_t * ans;
+    uint32_t counts[BIT_QUEUE_ANS_MAX_SYMBOLS] = {0};
+    uint8_t values[CODEC_VALUES];
+    uint8_t got[CODEC_VALUES] = {0};
+    size_t lengths[CODEC_VALUES];
+    size_t streams[CODEC_VALUES];
+    size_t symbol_count = 1 + rng() % BIT_QUEUE_ANS_MAX_SYMBOLS;
+    size_t i, written = 0, read = 0;
+    int ret_val = 0;
+    int ret;
+    // skewed counts with some unused symbols, sometimes a single symbol that takes the whole scale
+    for (i = 0; i < symbol_count; i++)
+    {
+        counts[i] = rng() % 4 ? random_value(100000) : 0;
+    }
+    counts[rng() % symbol_count] += 1;
+    ans = bit_queue_ans_init(counts, symbol_count);
+    for (i = 0; i < CODEC_VALUES; i++)
+    {
+        for (values[i] = rng() % symbol_count; !counts[values[i]]; values[i] = (values[i] + 1) % symbol_count)
+        {
+        }
+    }
+    while (!ret_val && read < CODEC_VALUES)
+    {
+        while (written < CODEC_VALUES)
+        {
+            lengths[written] = chunk_length(written);
+            streams[written] = 1 + rng() % BIT_QUEUE_ANS_MAX_STREAMS;
+            if (bit_queue_write_ans(bq, ans, values + written, lengths[written], streams[written]) == -1)
+            {
+                break;
+            }
+            written += lengths[written];
+        }
+        if (written < CODEC_VALUES && errno != EAGAIN)
+        {
+            ret_val = codec_mismatch("write_ans", written, -1, 0, 0);
+        }
+        for (; !ret_val && read < written; read += lengths[read])
+        {
+            if ((ret = bit_queue_read_ans(bq, ans, got, lengths[read], streams[read])) == -1 ||
+                memcmp(got, values + read, lengths[read]))
+            {
+                for (i = 0; ret != -1 && got[i] == values[read + i]; i++)
+                {
+                }
+                ret_val = codec_mismatch("read_ans", read + i, ret, got[i], values[read + i]);
+            }
+        }
+    }
+    bit_queue_ans_destroy(ans);
+    bit_queue_destroy(bq);
+    return ret_val;
+}
+
+static int codec_rice(void)
+{
+    bit_queue_t * bq = codec_queue(CODEC_VALUES * 9);
+    uint32_t values[CODEC_VALUES];
+    uint32_t got[CODEC_VALUES] = {0};
+    size_t lengths[CODEC_VALUES];
+    uint8_t ks[CODEC_VALUES];
+    size_t i, written = 0, read = 0;
+    uint32_t scale = UINT32_MAX >> (rng() % 32);
+    int ret_val = 0;
+    int ret;
+    for (i = 0; i < CODEC_VALUES; i++)
+    {
+        // the values of a round share a magnitude so the adaptive k has something to adapt to, a few escape
+        values[i] = rng() % 16 ? random_value(scale) : (uint32_t)rng();
+    }
+    while (!ret_val && read < CODEC_VALUES)
+    {
+        // a chunk of length 1 is a single code with a random k, the longer chunks are adaptive arrays
+        while (written < CODEC_VALUES)
+        {
+            lengths[written] = chunk_length(written);
+            ks[written] = rng() % (BIT_QUEUE_RICE_MAX_K + 1);
+            if ((lengths[written] == 1 ? bit_queue_write_rice(bq, values[written], ks[written]) :
+                 bit_queue_write_rice_u32(bq, values + written, lengths[written])) == -1)
+            {
+                break;
+            }
+            written += lengths[written];
+        }
+        if (written < CODEC_VALUES && errno != EAGAIN)
+        {
+            ret_val = codec_mismatch("write_rice", written, -1, 0, 0);
+        }
+        for (; !ret_val && read < written; read += lengths[read])
+        {
+            if ((ret = lengths[read] == 1 ? bit_queue_read_rice(bq, got, ks[read]) : bit_queue_read_rice_u32(bq, got, lengths[read])) == -1 ||
+                memcmp(got, values + read, lengths[read] * sizeof(uint32_t)))
+            {
+                for (i = 0; ret != -1 && got[i] == values[read + i]; i++)
+                {
+                }
+                ret_val = codec_mismatch(lengths[read] == 1 ? "read_rice" : "read_rice_u32", read + i, ret, got[i], values[read + i]);
+            }
+        }
+    }
+    bit_queue_destroy(bq);
+    return ret_val;
+}
+
+static int codec_lz(void)
+{
+    static uint8_t src[CODEC_LZ_BYTES], dst[BIT_QUEUE_LZ_BOUND(CODEC_LZ_BYTES)], got[CODEC_LZ_BYTES];
+    size_t size = 1 + rng() % CODEC_LZ_BYTES;
+    size_t alphabet = 1 + rng() % 256;
+    size_t i, offset, length;
+    int ret_val = 0;
+    int ret;
+    // random literals from a random alphabet mixed with copies of earlier bytes at random distances
+    for (i = 0; i < size;)
+    {
+        length = 1 + rng() % 64;
+        length = length < size - i ? length : size - i;
+        if (i && rng() % 2)
+        {
+            // a copy of earlier bytes, it overlaps itself when the distance is shorter than the length
+            for (offset = i - 1 - rng() % i; length > 0; length--)
+            {
+                src[i++] = src[offset++];
+            }
+        }
+        else
+        {
+            for (; length > 0; length--)
+            {
+                src[i++] = rng() % alphabet;
+            }
+        }
+    }
+    if ((ret = bit_queue_lz_compress(src, size, dst, sizeof(dst))) == -1)
+    {
+        ret_val = codec_mismatch("lz_compress", size, ret, 0, 0);
+    }
+    else if ((ret = bit_queue_lz_decompress(dst, ret, got, sizeof(got))) != (int)size || memcmp(got, src, size))
+    {
+        for (i = 0; ret != -1 && got[i] == src[i]; i++)
+        {
+        }
+        ret_val = codec_mismatch("lz_decompress", i, ret, got[i], src[i]);
+    }
+    return ret_val;
+}
+
+static int codecs(void)
+{
+    int ret_val = 0;
+    size_t i;
+    for (i = 0; i < CODEC_ROUNDS && !ret_val; i++)
+    {
+        ret_val = codec_golomb();
+        if (!ret_val)
+        {
+            ret_val = codec_varint();
+        }
+        if (!ret_val)
+        {
+            ret_val = codec_pack();
+        }
+        if (!ret_val)
+        {
+            ret_val = codec_frames();
+        }
+        if (!ret_val)
+        {
+            ret_val = codec_huffman();
+        }
+        if (!ret_val)
+        {
+            ret_val = codec_ans();
+        }
+        if (!ret_val)
+        {
+            ret_val = codec_rice();
+        }
+        if (!ret_val)
+        {
+            ret_val = codec_lz();
+        }
+    }
+    return ret_val;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 0) : 1;
+    unsigned long sequences = argc > 2 ? strtoul(argv[2], NULL, 0) : 2000;
+    unsigned long i;
+    int ret_val;
+    rng_state = seed ? seed : 1;
+    ret_val = exhaustive();
+    for (i = 0; i < sequences && !ret_val; i++)
+    {
+        ret_val = sequence();
+    }
+    if (!ret_val)
+    {
+        ret_val = codecs();
+    }
+    if (ret_val)
+    {
+        printf("seed=%llu sequence=%lu\n", seed, i);
+    }
+    else
+    {
+        printf("differential seed=%llu sequences=%lu ok\n", seed, sequences);
+    }
+    return ret_val ? EXIT_FAILURE : EXIT_SUCCESS;
+}
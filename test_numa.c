@@ -0,0 +1,58 @@
+/**
+ * @file test_numa.c
+ * @author amitfr1
+ * @brief Test of the NUMA placement of the bit queue buffer and of pinning a thread to it
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * Node 0 exists on every NUMA system, so a buffer bound to it must be reported on node 0 and a thread pinned to it
+ * must run on node 0. A kernel without NUMA support (or a seccomp filter that denies the memory policy calls) skips
+ * the test with the CTest skip code.
+ */
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "bit_queue.h"
+#include "test_check.h"
+
+#define SKIP_CODE 77
+
+int main()
+{
+    bit_queue_attr_t attr;
+    bit_queue_t * bq;
+    unsigned int cpu, node;
+    bq = bit_queue_base_init(64);
+    if (bit_queue_numa_node(bq) == -1 && (errno == ENOSYS || errno == EPERM))
+    {
+        printf("numa not supported, skipped\n");
+        bit_queue_destroy(bq);
+        return SKIP_CODE;
+    }
+    bit_queue_destroy(bq);
+    bit_queue_attr_init(&attr);
+    attr.numa_node = 0;
+    bq = bit_queue_base_init_attr(64, &attr);
+    check("bind node 0", bq != NULL, 1);
+    if (bq != NULL)
+    {
+        check("buffer node", bit_queue_numa_node(bq), 0);
+        check("pin", bit_queue_numa_pin_thread(bq), 0);
+        check("thread node", syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node == 0, 1);
+        bit_queue_destroy(bq);
+    }
+    // the local node is the node the creating thread runs on, node 0 after the pin
+    attr.numa_node = BIT_QUEUE_NUMA_LOCAL;
+    bq = bit_queue_base_init_attr(64, &attr);
+    check("bind local node", bq != NULL, 1);
+    if (bq != NULL)
+    {
+        check("local buffer node", bit_queue_numa_node(bq), 0);
+        bit_queue_destroy(bq);
+    }
+    attr.numa_node = BIT_QUEUE_NUMA_LOCAL - 1;
+    check("bind invalid node", bit_queue_base_init_attr(64, &attr) == NULL && errno == EINVAL, 1);
+    check("pin NULL", bit_queue_numa_pin_thread(NULL) == -1 && errno == EINVAL, 1);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file test_shm.c
+ * @author amitfr1
+ * @brief Test of a shared memory bit queue between a writer and a reader process
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The creator leaves the queue holding data that wraps the end of the buffer and starts at an unaligned bit before
+ * the reader process attaches, so the attached handle must continue from the published counters. The processes then
+ * pass a counter sequence with the blocking reads and writes, which wake each other through the shared futexes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "bit_queue.h"
+#include "test_check.h"
+
+#define SEQUENCE_VALUES 20000
+#define SEQUENCE_BITS 13
+#define WAKE_TIMEOUT_S 10
+#define HELD_VALUE 0xa1b2c3d4e5f6ULL
+#define HELD_BITS 48
+
+static int reader(const char *name)
+{
+    bit_queue_t * bq = bit_queue_shm_attach(name);
+    struct timespec timeout = {WAKE_TIMEOUT_S, 0};
+    uint64_t value = 0;
+    uint32_t i, counter;
+    check("reader attach", bq != NULL, 1);
+    if (bq != NULL)
+    {
+        check("reader held bits", bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), HELD_BITS), HELD_BITS);
+        check("reader held value", value == HELD_VALUE, 1);
+        for (i = 0; i < SEQUENCE_VALUES; i++)
+        {
+            counter = 0;
+            if (bit_queue_read_bits_wait(bq, (uint8_t*)&counter, sizeof(counter), SEQUENCE_BITS, &timeout) != SEQUENCE_BITS || counter != (i & ((1 << SEQUENCE_BITS) - 1)))
+            {
+                break;
+            }
+        }
+        check("reader sequence values", i, SEQUENCE_VALUES);
+        bit_queue_destroy(bq);
+    }
+    return failures ? 1 : 0;
+}
+
+int main()
+{
+    bit_queue_t * bq;
+    char name[64];
+    struct timespec timeout = {WAKE_TIMEOUT_S, 0};
+    uint64_t value = HELD_VALUE;
+    uint32_t i;
+    pid_t pid;
+    int status = -1;
+    int fd;
+    snprintf(name, sizeof(name), "/bit_queue_test_shm_%d", (int)getpid());
+    bq = bit_queue_shm_create(name, 8);
+    check("create", bq != NULL, 1);
+    if (bq == NULL)
+    {
+        return 1;
+    }
+    check("create existing", bit_queue_shm_create(name, 8) == NULL && errno == EEXIST, 1);
+    // the held bits start at bit 37 and wrap the end of the 64 bit buffer
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 37);
+    bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), 37);
+    value = HELD_VALUE;
+    check("held bits", bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), HELD_BITS), HELD_BITS);
+    fflush(stdout);
+    if ((pid = fork()) == 0)
+    {
+        // the reader uses its own handle, not the copy of the creator's
+        bit_queue_destroy(bq);
+        exit(reader(name));
+    }
+    check("fork", pid > 0, 1);
+    for (i = 0; i < SEQUENCE_VALUES && pid > 0; i++)
+    {
+        if (bit_queue_write_bits_wait(bq, (uint8_t*)&i, sizeof(i), SEQUENCE_BITS, &timeout) != SEQUENCE_BITS)
+        {
+            break;
+        }
+    }
+    check("writer sequence values", i, SEQUENCE_VALUES);
+    if (pid > 0)
+    {
+        waitpid(pid, &status, 0);
+    }
+    check("reader exit status", WIFEXITED(status) ? WEXITSTATUS(status) : -1, 0);
+    bit_queue_destroy(bq);
+    shm_unlink(name);
+    check("attach missing", bit_queue_shm_attach(name) == NULL && errno == ENOENT, 1);
+    // an empty segment doesn't hold a bit queue
+    if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) != -1)
+    {
+        close(fd);
+        check("attach empty", bit_queue_shm_attach(name) == NULL && errno == EINVAL, 1);
+        shm_unlink(name);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file test_threads.c
+ * @author amitfr1
+ * @brief Test of the blocking reads and writes between a producer and a consumer thread
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * The waits are checked to expire at their timeout on an empty and on a full queue, a sleeping reader and writer are
+ * checked to stay asleep until the opposite side crosses their target and then to wake, and a producer and a consumer
+ * pass a counter sequence through a queue much smaller than the sequence so both sides block many times.
+ * The eventfds are checked to follow the watermark crossings and a thread polling the read fd is checked to wake
+ * when the writer crosses the read watermark.
+ */
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include "bit_queue.h"
+#include "test_check.h"
+
+#define SEQUENCE_VALUES 100000
+#define SEQUENCE_BITS 17
+#define TIMEOUT_NS 20000000L
+#define SLEEP_NS 50000000L
+#define WAKE_TIMEOUT_S 10
+
+/**
+ * @brief This stuct holds a blocking call made from a thread and its result
+ */
+typedef struct _waiter_t
+{
+    bit_queue_t *bq;
+    uint32_t value;
+    size_t bit_count;
+    struct timespec timeout;
+    int ret;
+    atomic_bool done;
+} waiter_t;
+
+static long long elapsed_ns(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000000LL + now.tv_nsec - start->tv_nsec;
+}
+
+static void sleep_ns(long ns)
+{
+    struct timespec duration = {0, ns};
+    nanosleep(&duration, NULL);
+}
+
+static void *read_waiter(void *arg)
+{
+    waiter_t * waiter = arg;
+    waiter->ret = bit_queue_read_bits_wait(waiter->bq, (uint8_t*)&waiter->value, sizeof(waiter->value), waiter->bit_count, &waiter->timeout);
+    atomic_store(&waiter->done, true);
+    return NULL;
+}
+
+static void *write_waiter(void *arg)
+{
+    waiter_t * waiter = arg;
+    waiter->ret = bit_queue_write_bits_wait(waiter->bq, (uint8_t*)&waiter->value, sizeof(waiter->value), waiter->bit_count, &waiter->timeout);
+    atomic_store(&waiter->done, true);
+    return NULL;
+}
+
+static void *poll_waiter(void *arg)
+{
+    waiter_t * waiter = arg;
+    struct pollfd pfd = {bit_queue_read_fd(waiter->bq), POLLIN, 0};
+    if ((waiter->ret = poll(&pfd, 1, WAKE_TIMEOUT_S * 1000)) == 1)
+    {
+        bit_queue_read_bits(waiter->bq, (uint8_t*)&waiter->value, sizeof(waiter->value), waiter->bit_count);
+    }
+    atomic_store(&waiter->done, true);
+    return NULL;
+}
+
+static int readable(int fd)
+{
+    struct pollfd pfd = {fd, POLLIN, 0};
+    return poll(&pfd, 1, 0);
+}
+
+static void *producer(void *arg)
+{
+    bit_queue_t * bq = arg;
+    struct timespec timeout = {WAKE_TIMEOUT_S, 0};
+    uint32_t i;
+    for (i = 0; i < SEQUENCE_VALUES; i++)
+    {
+        if (bit_queue_write_bits_wait(bq, (uint8_t*)&i, sizeof(i), SEQUENCE_BITS, &timeout) != SEQUENCE_BITS)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void timeouts(void)
+{
+    bit_queue_t * bq = bit_queue_base_init(4);
+    struct timespec timeout = {0, TIMEOUT_NS};
+    struct timespec start;
+    uint32_t value = 0;
+    // nothing is written so the read sleeps until the deadline
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    check("read wait timeout", bit_queue_read_bits_wait(bq, (uint8_t*)&value, sizeof(value), 8, &timeout) == -1 && errno == ETIMEDOUT, 1);
+    check("read wait timeout elapsed", elapsed_ns(&start) >= TIMEOUT_NS, 1);
+    // a read of 8 bits from 7 bits doesn't return early
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 7);
+    check("read wait short", bit_queue_read_bits_wait(bq, (uint8_t*)&value, sizeof(value), 8, &timeout) == -1 && errno == ETIMEDOUT, 1);
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 25);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    check("write wait timeout", bit_queue_write_bits_wait(bq, (uint8_t*)&value, sizeof(value), 8, &timeout) == -1 && errno == ETIMEDOUT, 1);
+    check("write wait timeout elapsed", elapsed_ns(&start) >= TIMEOUT_NS, 1);
+    // a queue that holds the bits doesn't wait
+    check("read wait ready", bit_queue_read_bits_wait(bq, (uint8_t*)&value, sizeof(value), 8, &timeout), 8);
+    check("write wait ready", bit_queue_write_bits_wait(bq, (uint8_t*)&value, sizeof(value), 8, &timeout), 8);
+    bit_queue_destroy(bq);
+}
+
+static void wakeups(void)
+{
+    bit_queue_t * bq = bit_queue_base_init(4);
+    waiter_t waiter;
+    pthread_t thread;
+    uint32_t value = 0xbeef;
+    memset(&waiter, 0, sizeof(waiter));
+    waiter.bq = bq;
+    waiter.bit_count = 16;
+    waiter.timeout.tv_sec = WAKE_TIMEOUT_S;
+    pthread_create(&thread, NULL, read_waiter, &waiter);
+    sleep_ns(SLEEP_NS);
+    // half of the bits the reader waits for don't wake it
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 8);
+    sleep_ns(SLEEP_NS);
+    check("reader asleep", atomic_load(&waiter.done), 0);
+    value >>= 8;
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 8);
+    pthread_join(thread, NULL);
+    check("reader woken", waiter.ret, 16);
+    check("reader value", waiter.value, 0xbeef);
+    // the queue is filled so the writer waits for 8 free bits
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 32);
+    memset(&waiter, 0, sizeof(waiter));
+    waiter.bq = bq;
+    waiter.value = 0xa5;
+    waiter.bit_count = 8;
+    waiter.timeout.tv_sec = WAKE_TIMEOUT_S;
+    pthread_create(&thread, NULL, write_waiter, &waiter);
+    sleep_ns(SLEEP_NS);
+    bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), 4);
+    sleep_ns(SLEEP_NS);
+    check("writer asleep", atomic_load(&waiter.done), 0);
+    bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), 4);
+    pthread_join(thread, NULL);
+    check("writer woken", waiter.ret, 8);
+    bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), 24);
+    value = 0;
+    check("writer value bits", bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), 8), 8);
+    check("writer value", value, 0xa5);
+    bit_queue_destroy(bq);
+}
+
+static void sequence(void)
+{
+    // the values cross the end of the buffer at every bit offset, the timeouts only stop a side left alone by a failure
+    bit_queue_t * bq = bit_queue_base_init(7);
+    struct timespec timeout = {WAKE_TIMEOUT_S, 0};
+    pthread_t thread;
+    uint32_t i, value;
+    pthread_create(&thread, NULL, producer, bq);
+    for (i = 0; i < SEQUENCE_VALUES; i++)
+    {
+        value = 0;
+        if (bit_queue_read_bits_wait(bq, (uint8_t*)&value, sizeof(value), SEQUENCE_BITS, &timeout) != SEQUENCE_BITS || value != (i & ((1 << SEQUENCE_BITS) - 1)))
+        {
+            break;
+        }
+    }
+    pthread_join(thread, NULL);
+    check("sequence values", i, SEQUENCE_VALUES);
+    bit_queue_destroy(bq);
+}
+
+static void watermarks(void)
+{
+    bit_queue_attr_t attr;
+    bit_queue_t * bq;
+    waiter_t waiter;
+    pthread_t thread;
+    uint32_t value = 0;
+    bit_queue_attr_init(&attr);
+    attr.flags = BIT_QUEUE_ATTR_EVENTFD;
+    attr.read_watermark = 16;
+    attr.write_watermark = 32;
+    bq = bit_queue_base_init_attr(8, &attr);
+    check("empty data fd", readable(bit_queue_read_fd(bq)), 0);
+    check("empty space fd", readable(bit_queue_write_fd(bq)), 1);
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 15);
+    check("below read watermark", readable(bit_queue_read_fd(bq)), 0);
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 1);
+    check("at read watermark", readable(bit_queue_read_fd(bq)), 1);
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 16);
+    check("at write watermark", readable(bit_queue_write_fd(bq)), 1);
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 1);
+    check("below write watermark", readable(bit_queue_write_fd(bq)), 0);
+    bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), 1);
+    check("back at write watermark", readable(bit_queue_write_fd(bq)), 1);
+    bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), 16);
+    check("still at read watermark", readable(bit_queue_read_fd(bq)), 1);
+    bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), 1);
+    check("back below read watermark", readable(bit_queue_read_fd(bq)), 0);
+    bit_queue_read_bits(bq, (uint8_t*)&value, sizeof(value), 15);
+    // a thread polling the read fd sleeps until the writer crosses the watermark
+    memset(&waiter, 0, sizeof(waiter));
+    waiter.bq = bq;
+    waiter.bit_count = 16;
+    pthread_create(&thread, NULL, poll_waiter, &waiter);
+    sleep_ns(SLEEP_NS);
+    value = 0x1234;
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 8);
+    sleep_ns(SLEEP_NS);
+    check("poller asleep", atomic_load(&waiter.done), 0);
+    value >>= 8;
+    bit_queue_write_bits(bq, (uint8_t*)&value, sizeof(value), 8);
+    pthread_join(thread, NULL);
+    check("poller woken", waiter.ret, 1);
+    check("poller value", waiter.value, 0x1234);
+    bit_queue_destroy(bq);
+}
+
+int main()
+{
+    timeouts();
+    wakeups();
+    sequence();
+    watermarks();
+    return failures ? 1 : 0;
+}